@@ -1,168 +1,812 @@
 #include "KosmosBase.h"
 #include <cmath>
 #include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <atomic>
 
-Chunk::Chunk(int x, int y, int z) : chunkX(x), chunkY(y), chunkZ(z), mesh(nullptr)
+Chunk::Chunk(int x, int y, int z) : chunkX(x), chunkY(y), chunkZ(z), mesh(nullptr), palette(1, Voxel())
 {
-    for (int i = 0; i < CHUNK_SIZE; ++i)
-        for (int j = 0; j < CHUNK_SIZE; ++j)
-            for (int k = 0; k < CHUNK_SIZE; ++k)
-                voxels[i][j][k] = Voxel(VoxelType::Empty);
 }
 
-Voxel &Chunk::getVoxel(int x, int y, int z)
+// Smallest index width (1, 2, 4 or 8 bits) for a palette, 0 if it needs dense storage.
+// Powers of two keep every index inside one 64-bit word.
+static int paletteBits(size_t entries)
 {
-    return voxels[x][y][z];
+    if (entries <= 2)
+        return 1;
+    if (entries <= 4)
+        return 2;
+    if (entries <= 16)
+        return 4;
+    if (entries <= 256)
+        return 8;
+    return 0;
 }
+
+uint32_t Chunk::paletteIndex(int i) const
+{
+    const int perWord = 64 / bits;
+    return (uint32_t)(packed[i / perWord] >> ((i % perWord) * bits)) & ((1u << bits) - 1);
+}
+
+void Chunk::setPaletteIndex(int i, uint32_t value)
+{
+    const int perWord = 64 / bits;
+    const int shift = (i % perWord) * bits;
+    const uint64_t mask = ((uint64_t(1) << bits) - 1) << shift;
+    uint64_t &word = packed[i / perWord];
+    word = (word & ~mask) | ((uint64_t)value << shift);
+}
+
+Voxel Chunk::getVoxel(int x, int y, int z) const
+{
+    switch (storage)
+    {
+    case Storage::Uniform:
+        return palette[0];
+    case Storage::Palette:
+        return palette[paletteIndex(index(x, y, z))];
+    default:
+        return dense[index(x, y, z)];
+    }
+}
+
+VoxelType Chunk::getType(int x, int y, int z) const
+{
+    return getVoxel(x, y, z).type;
+}
+
 void Chunk::setVoxel(int x, int y, int z, VoxelType type, uint8_t data)
 {
-    voxels[x][y][z] = Voxel(type, data);
+    const Voxel voxel(type, data);
+    const int i = index(x, y, z);
+    if (storage == Storage::Dense)
+    {
+        dense[i] = voxel;
+        return;
+    }
+    uint32_t entry = (uint32_t)(std::find(palette.begin(), palette.end(), voxel) - palette.begin());
+    if (entry == palette.size())
+    {
+        if (storage == Storage::Uniform)
+        {
+            // Every voxel keeps index 0, the old uniform value
+            storage = Storage::Palette;
+            bits = 1;
+            packed.assign(CHUNK_VOLUME / 64, 0);
+        }
+        else if (palette.size() == (size_t(1) << bits))
+        {
+            const int wider = paletteBits(palette.size() + 1);
+            if (!wider)
+            {
+                toDense();
+                dense[i] = voxel;
+                return;
+            }
+            std::vector<uint32_t> indices(CHUNK_VOLUME);
+            for (int k = 0; k < CHUNK_VOLUME; ++k)
+                indices[k] = paletteIndex(k);
+            bits = wider;
+            packed.assign(CHUNK_VOLUME * bits / 64, 0);
+            for (int k = 0; k < CHUNK_VOLUME; ++k)
+                setPaletteIndex(k, indices[k]);
+        }
+        palette.push_back(voxel);
+    }
+    if (storage == Storage::Palette)
+        setPaletteIndex(i, entry);
+}
+
+void Chunk::toDense()
+{
+    dense.reset(new Voxel[CHUNK_VOLUME]);
+    for (int i = 0; i < CHUNK_VOLUME; ++i)
+        dense[i] = storage == Storage::Uniform ? palette[0] : palette[paletteIndex(i)];
+    storage = Storage::Dense;
+    palette = std::vector<Voxel>();
+    packed = std::vector<uint64_t>();
+    bits = 0;
+}
+
+void Chunk::store(const Voxel *voxels, std::vector<Voxel> newPalette)
+{
+    dense.reset();
+    packed = std::vector<uint64_t>();
+    bits = paletteBits(newPalette.size());
+    if (newPalette.size() == 1)
+    {
+        storage = Storage::Uniform;
+        palette = std::move(newPalette);
+        bits = 0;
+        return;
+    }
+    if (!bits)
+    {
+        storage = Storage::Dense;
+        palette = std::vector<Voxel>();
+        dense.reset(new Voxel[CHUNK_VOLUME]);
+        std::copy(voxels, voxels + CHUNK_VOLUME, dense.get());
+        return;
+    }
+    storage = Storage::Palette;
+    palette = std::move(newPalette);
+    palette.shrink_to_fit();
+    packed.assign(CHUNK_VOLUME * bits / 64, 0);
+    uint32_t entry = 0;
+    for (int i = 0; i < CHUNK_VOLUME; ++i)
+    {
+        // Neighbouring voxels mostly match, so try the last entry before searching
+        if (palette[entry] != voxels[i])
+            entry = (uint32_t)(std::find(palette.begin(), palette.end(), voxels[i]) - palette.begin());
+        setPaletteIndex(i, entry);
+    }
+}
+
+void Chunk::assign(const Voxel *voxels)
+{
+    std::vector<Voxel> newPalette(1, voxels[0]);
+    for (int i = 1; i < CHUNK_VOLUME && newPalette.size() <= 256; ++i)
+    {
+        if (voxels[i] != voxels[i - 1] &&
+            std::find(newPalette.begin(), newPalette.end(), voxels[i]) == newPalette.end())
+            newPalette.push_back(voxels[i]);
+    }
+    store(voxels, std::move(newPalette));
+}
+
+void Chunk::compact()
+{
+    if (storage == Storage::Uniform)
+        return;
+    std::vector<Voxel> voxels(CHUNK_VOLUME);
+    for (int i = 0; i < CHUNK_VOLUME; ++i)
+        voxels[i] = storage == Storage::Dense ? dense[i] : palette[paletteIndex(i)];
+    assign(voxels.data());
+}
+
+void Chunk::decodeTypes(uint8_t *types) const
+{
+    switch (storage)
+    {
+    case Storage::Uniform:
+        std::fill(types, types + CHUNK_VOLUME, (uint8_t)palette[0].type);
+        break;
+    case Storage::Palette:
+    {
+        // Unpack a word at a time through a type lookup table
+        uint8_t lut[256];
+        for (size_t p = 0; p < palette.size(); ++p)
+            lut[p] = (uint8_t)palette[p].type;
+        const int perWord = 64 / bits;
+        const uint64_t mask = (uint64_t(1) << bits) - 1;
+        for (size_t w = 0; w < packed.size(); ++w)
+        {
+            uint64_t word = packed[w];
+            for (int k = 0; k < perWord; ++k, word >>= bits)
+                *types++ = lut[word & mask];
+        }
+        break;
+    }
+    default:
+        for (int i = 0; i < CHUNK_VOLUME; ++i)
+            types[i] = (uint8_t)dense[i].type;
+        break;
+    }
+}
+
+size_t Chunk::memoryBytes() const
+{
+    return sizeof(Chunk) + palette.capacity() * sizeof(Voxel) + packed.capacity() * sizeof(uint64_t) +
+           (dense ? CHUNK_VOLUME * sizeof(Voxel) : 0);
+}
+
+size_t ChunkMap::hash(uint64_t key)
+{
+    // splitmix64 finalizer: neighbouring chunks land in unrelated slots
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ull;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebull;
+    key ^= key >> 31;
+    return (size_t)key;
 }
 
-Asteroid::Asteroid(int dx, int dy, int dz, uint32_t seed) : dimX(dx), dimY(dy), dimZ(dz)
+uint32_t ChunkMap::find(uint64_t key) const
+{
+    if (slots.empty())
+        return NONE;
+    const size_t mask = slots.size() - 1;
+    for (size_t i = hash(key) & mask;; i = (i + 1) & mask)
+    {
+        const Slot &slot = slots[i];
+        if (slot.value == NONE || slot.key == key)
+            return slot.value;
+    }
+}
+
+void ChunkMap::insert(uint64_t key, uint32_t value)
+{
+    if ((count + 1) * 2 > slots.size())
+    {
+        std::vector<Slot> old(slots.empty() ? 64 : slots.size() * 2, Slot{0, NONE});
+        old.swap(slots);
+        count = 0;
+        for (const Slot &slot : old)
+        {
+            if (slot.value != NONE)
+                insert(slot.key, slot.value);
+        }
+    }
+    const size_t mask = slots.size() - 1;
+    size_t i = hash(key) & mask;
+    while (slots[i].value != NONE && slots[i].key != key)
+        i = (i + 1) & mask;
+    if (slots[i].value == NONE)
+        ++count;
+    slots[i] = Slot{key, value};
+}
+
+static std::atomic<uint64_t> g_nextAsteroidId(1);
+
+Asteroid::Asteroid(int dx, int dy, int dz, uint32_t seed, bool greedy)
+    : dimX(dx), dimY(dy), dimZ(dz), greedyMeshing(greedy), id(g_nextAsteroidId++)
 {
-    for (int cz = 0; cz < dz; ++cz)
-        for (int cy = 0; cy < dy; ++cy)
-            for (int cx = 0; cx < dx; ++cx)
-                chunks.push_back(std::make_unique<Chunk>(cx, cy, cz));
     generate(seed);
 }
 
+Asteroid::~Asteroid()
+{
+    // Jobs hold a pointer to this asteroid
+    waitForMeshes();
+}
+
 Chunk *Asteroid::getChunk(int cx, int cy, int cz)
 {
-    if (cx < 0 || cy < 0 || cz < 0 || cx >= dimX || cy >= dimY || cz >= dimZ)
-        return nullptr;
-    return chunks[cx + cy * dimX + cz * dimX * dimY].get();
+    return const_cast<Chunk *>(static_cast<const Asteroid *>(this)->getChunk(cx, cy, cz));
 }
 
-Voxel *Asteroid::getVoxel(int wx, int wy, int wz)
+const Chunk *Asteroid::getChunk(int cx, int cy, int cz) const
 {
-    int cx = wx / CHUNK_SIZE, cy = wy / CHUNK_SIZE, cz = wz / CHUNK_SIZE;
-    int lx = wx % CHUNK_SIZE, ly = wy % CHUNK_SIZE, lz = wz % CHUNK_SIZE;
-    Chunk *chunk = getChunk(cx, cy, cz);
-    if (!chunk)
-        return nullptr;
-    return &chunk->getVoxel(lx, ly, lz);
+    const uint32_t index = chunkIndex(cx, cy, cz);
+    return index == ChunkMap::NONE ? nullptr : chunks[index].get();
+}
+
+Chunk *Asteroid::addChunk(std::unique_ptr<Chunk> chunk)
+{
+    const uint32_t index = (uint32_t)chunks.size();
+    chunkMap.insert(ChunkMap::key(chunk->chunkX, chunk->chunkY, chunk->chunkZ), index);
+    chunks.push_back(std::move(chunk));
+    meshVersions.push_back(0);
+    dirtyFlags.push_back(0);
+    return chunks.back().get();
+}
+
+// World to chunk coordinates, rounding towards -infinity so -1 lands in chunk -1
+static inline int chunkCoord(int w)
+{
+    return w >> CHUNK_SHIFT;
+}
+
+static inline int localCoord(int w)
+{
+    return w & (CHUNK_SIZE - 1);
+}
+
+Voxel Asteroid::getVoxel(int wx, int wy, int wz) const
+{
+    // Chunks are never freed while the asteroid lives, so a cached pointer stays valid;
+    // the id keeps one asteroid from hitting another's entry
+    struct LastChunk
+    {
+        uint64_t owner = 0;
+        uint64_t key = 0;
+        const Chunk *chunk = nullptr;
+    };
+    thread_local LastChunk last;
+    const int cx = chunkCoord(wx), cy = chunkCoord(wy), cz = chunkCoord(wz);
+    const uint64_t key = ChunkMap::key(cx, cy, cz);
+    if (last.owner != id || last.key != key)
+    {
+        const uint32_t index = chunkMap.find(key);
+        if (index == ChunkMap::NONE)
+            return Voxel();
+        last.owner = id;
+        last.key = key;
+        last.chunk = chunks[index].get();
+    }
+    return last.chunk->getVoxel(localCoord(wx), localCoord(wy), localCoord(wz));
+}
+
+Asteroid::StorageStats Asteroid::storageStats() const
+{
+    StorageStats stats;
+    for (const auto &chunk : chunks)
+    {
+        switch (chunk->getStorage())
+        {
+        case Chunk::Storage::Uniform:
+            ++stats.uniformChunks;
+            break;
+        case Chunk::Storage::Palette:
+            ++stats.paletteChunks;
+            break;
+        default:
+            ++stats.denseChunks;
+            break;
+        }
+        stats.bytes += chunk->memoryBytes();
+    }
+    // A chunk with a plain Voxel[16][16][16] array instead of the storage members
+    stats.denseBytes = chunks.size() * (sizeof(Chunk) + CHUNK_VOLUME * sizeof(Voxel));
+    return stats;
+}
+
+// Chunk plus a one-voxel halo from its 26 neighbours, as voxel types indexed [x][y][z].
+// Out-of-world halo cells are Empty, so faces on the asteroid's surface stay exposed.
+constexpr int PADDED_SIZE = CHUNK_SIZE + 2;
+constexpr int PADDED_STRIDE[3] = {PADDED_SIZE * PADDED_SIZE, PADDED_SIZE, 1};
+
+// Fill volume for chunk (cx, cy, cz); false if the chunk itself holds no solid voxel
+static bool gatherPaddedChunk(const Asteroid &asteroid, int cx, int cy, int cz, uint8_t *volume)
+{
+    const Chunk *chunk = asteroid.getChunk(cx, cy, cz);
+    if (chunk->isUniform() && chunk->getType(0, 0, 0) == VoxelType::Empty)
+        return false;
+    uint8_t types[CHUNK_VOLUME];
+    chunk->decodeTypes(types);
+    uint8_t solid = 0;
+    for (int x = 0; x < CHUNK_SIZE; ++x)
+    {
+        for (int y = 0; y < CHUNK_SIZE; ++y)
+        {
+            const uint8_t *src = types + (x * CHUNK_SIZE + y) * CHUNK_SIZE;
+            uint8_t *row = volume + (x + 1) * PADDED_STRIDE[0] + (y + 1) * PADDED_STRIDE[1] + 1;
+            for (int z = 0; z < CHUNK_SIZE; ++z)
+            {
+                row[z] = src[z];
+                solid |= src[z];
+            }
+        }
+    }
+    if (!solid)
+        return false;
+
+    // Per axis, neighbour offset -1 covers padded cell 0 (its last layer), 0 the interior
+    // cells 1..16, +1 cell 17 (its first layer)
+    static const int begin[3] = {0, 1, CHUNK_SIZE + 1};
+    static const int end[3] = {1, CHUNK_SIZE + 1, PADDED_SIZE};
+    for (int oz = -1; oz <= 1; ++oz)
+    {
+        for (int oy = -1; oy <= 1; ++oy)
+        {
+            for (int ox = -1; ox <= 1; ++ox)
+            {
+                if (ox == 0 && oy == 0 && oz == 0)
+                    continue;
+                const Chunk *src = asteroid.getChunk(cx + ox, cy + oy, cz + oz);
+                // Missing and uniform neighbours fill their part of the halo with one value
+                const bool fill = !src || src->isUniform();
+                const uint8_t fillType = src ? (uint8_t)src->getType(0, 0, 0) : (uint8_t)VoxelType::Empty;
+                // Padded cell p maps to the neighbour's local cell p - 1 - offset * CHUNK_SIZE
+                for (int x = begin[ox + 1]; x < end[ox + 1]; ++x)
+                {
+                    for (int y = begin[oy + 1]; y < end[oy + 1]; ++y)
+                    {
+                        uint8_t *row = volume + x * PADDED_STRIDE[0] + y * PADDED_STRIDE[1];
+                        for (int z = begin[oz + 1]; z < end[oz + 1]; ++z)
+                        {
+                            row[z] = fill ? fillType
+                                          : (uint8_t)src->getType(x - 1 - ox * CHUNK_SIZE, y - 1 - oy * CHUNK_SIZE,
+                                                                  z - 1 - oz * CHUNK_SIZE);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return true;
 }
 
 void Asteroid::setVoxel(int wx, int wy, int wz, VoxelType type, uint8_t data)
 {
-    int cx = wx / CHUNK_SIZE, cy = wy / CHUNK_SIZE, cz = wz / CHUNK_SIZE;
-    int lx = wx % CHUNK_SIZE, ly = wy % CHUNK_SIZE, lz = wz % CHUNK_SIZE;
+    const int cx = chunkCoord(wx), cy = chunkCoord(wy), cz = chunkCoord(wz);
+    const int lx = localCoord(wx), ly = localCoord(wy), lz = localCoord(wz);
     Chunk *chunk = getChunk(cx, cy, cz);
-    if (!chunk)
+    if (!chunk && type == VoxelType::Empty)
         return;
+    // Mesh jobs read chunks and the chunk map, so neither may change under them
+    if (passInFlight)
+        waitForMeshes();
+    if (!chunk)
+        chunk = addChunk(std::make_unique<Chunk>(cx, cy, cz));
     chunk->setVoxel(lx, ly, lz, type, data);
+    // Neighbours only read the layer touching this chunk (see gatherPaddedChunk)
+    markDirty(cx, cy, cz);
+    if (lx == 0)
+        markDirty(cx - 1, cy, cz);
+    else if (lx == CHUNK_SIZE - 1)
+        markDirty(cx + 1, cy, cz);
+    if (ly == 0)
+        markDirty(cx, cy - 1, cz);
+    else if (ly == CHUNK_SIZE - 1)
+        markDirty(cx, cy + 1, cz);
+    if (lz == 0)
+        markDirty(cx, cy, cz - 1);
+    else if (lz == CHUNK_SIZE - 1)
+        markDirty(cx, cy, cz + 1);
+}
+
+void Asteroid::markDirty(int cx, int cy, int cz)
+{
+    const uint32_t index = chunkIndex(cx, cy, cz);
+    if (index == ChunkMap::NONE)
+        return;
+    if (dirtyFlags[index])
+        return;
+    dirtyFlags[index] = 1;
+    dirtyQueue.push_back(index);
 }
 
 void Asteroid::generate(uint32_t seed)
 {
+    waitForMeshes();
     PerlinNoise noise(seed);
     int wxMax = dimX * CHUNK_SIZE, wyMax = dimY * CHUNK_SIZE, wzMax = dimZ * CHUNK_SIZE;
     glm::vec3 center(wxMax / 2.0f, wyMax / 2.0f, wzMax / 2.0f);
     float baseRadius = std::min({wxMax, wyMax, wzMax}) * 0.45f;
-    for (int z = 0; z < wzMax; ++z)
+    // Each candidate chunk is filled and compressed by its own job; the noise is read-only.
+    // New chunks that come out all Empty are dropped instead of being stored.
+    std::vector<Chunk *> targets;
+    std::vector<std::unique_ptr<Chunk>> fresh; // Null where the chunk already exists
+    for (int cz = 0; cz < dimZ; ++cz)
     {
-        for (int y = 0; y < wyMax; ++y)
+        for (int cy = 0; cy < dimY; ++cy)
         {
-            for (int x = 0; x < wxMax; ++x)
+            for (int cx = 0; cx < dimX; ++cx)
             {
-                glm::vec3 p(x, y, z);
-                float r = glm::length(p - center);
-                float n = noise.noise(x * 0.07f, y * 0.07f, z * 0.07f);
-                float potato = baseRadius + n * (baseRadius * 0.25f);
-                if (r < potato)
-                    setVoxel(x, y, z, VoxelType::Stone);
+                Chunk *chunk = getChunk(cx, cy, cz);
+                fresh.push_back(chunk ? nullptr : std::make_unique<Chunk>(cx, cy, cz));
+                targets.push_back(chunk ? chunk : fresh.back().get());
             }
         }
     }
-    for (int cz = 0; cz < dimZ; ++cz)
-        for (int cy = 0; cy < dimY; ++cy)
-            for (int cx = 0; cx < dimX; ++cx)
-                generateChunkMesh(cx, cy, cz);
+    DotBlue::GetJobSystem().parallelFor(targets.size(), [&](size_t i)
+    {
+        Chunk &chunk = *targets[i];
+        std::vector<Voxel> voxels(CHUNK_VOLUME);
+        for (int lx = 0; lx < CHUNK_SIZE; ++lx)
+        {
+            for (int ly = 0; ly < CHUNK_SIZE; ++ly)
+            {
+                for (int lz = 0; lz < CHUNK_SIZE; ++lz)
+                {
+                    const int x = chunk.chunkX * CHUNK_SIZE + lx;
+                    const int y = chunk.chunkY * CHUNK_SIZE + ly;
+                    const int z = chunk.chunkZ * CHUNK_SIZE + lz;
+                    glm::vec3 p(x, y, z);
+                    float r = glm::length(p - center);
+                    float n = noise.noise(x * 0.07f, y * 0.07f, z * 0.07f);
+                    float potato = baseRadius + n * (baseRadius * 0.25f);
+                    if (r < potato)
+                        voxels[(lx * CHUNK_SIZE + ly) * CHUNK_SIZE + lz] = Voxel(VoxelType::Stone);
+                }
+            }
+        }
+        chunk.assign(voxels.data());
+        if (fresh[i] && chunk.isUniform() && chunk.getVoxel(0, 0, 0).type == VoxelType::Empty)
+        {
+            fresh[i].reset();
+            targets[i] = nullptr;
+        }
+    });
+    size_t elided = 0;
+    for (size_t i = 0; i < fresh.size(); ++i)
+    {
+        if (fresh[i])
+            addChunk(std::move(fresh[i]));
+        else if (!targets[i])
+            ++elided;
+    }
+    printf("[Asteroid] %zu of %zu chunks allocated (%zu empty elided)\n", targets.size() - elided,
+           targets.size(), elided);
+    const StorageStats storage = storageStats();
+    printf("[Asteroid] voxel storage: %zu uniform, %zu palette, %zu dense chunks; %.1f KB (dense: %.1f KB, %.1f%% saved)\n",
+           storage.uniformChunks, storage.paletteChunks, storage.denseChunks, storage.bytes / 1024.0,
+           storage.denseBytes / 1024.0,
+           storage.denseBytes ? 100.0 * (1.0 - (double)storage.bytes / storage.denseBytes) : 0.0);
+    meshAllChunks();
+}
+
+void Asteroid::meshAllChunks()
+{
+    waitForMeshes();
+    DotBlue::JobSystem &jobs = DotBlue::GetJobSystem();
+    {
+        std::lock_guard<std::mutex> lock(meshMutex);
+        pendingMeshes += chunks.size();
+    }
+    dirtyQueue.clear();
+    std::fill(dirtyFlags.begin(), dirtyFlags.end(), 0);
+    passInFlight = true;
+    meshStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        const uint32_t version = ++meshVersions[i];
+        jobs.submit([this, i, version]
+        {
+            const Chunk &chunk = *chunks[i];
+            MeshStats stats;
+            MeshResult result{i, version, buildChunkMesh(chunk.chunkX, chunk.chunkY, chunk.chunkZ, stats)};
+            std::lock_guard<std::mutex> lock(meshMutex);
+            readyMeshes.push_back(std::move(result));
+            --pendingMeshes;
+        });
+    }
+}
+
+size_t Asteroid::remeshDirtyChunks(size_t maxChunks)
+{
+    // Called every frame: don't stall on the startup pass when nothing was edited
+    if (dirtyQueue.empty())
+        return 0;
+    // Edits must see the finished pass, not race it
+    if (passInFlight)
+        waitForMeshes();
+    DotBlue::JobSystem &jobs = DotBlue::GetJobSystem();
+    size_t queued = 0;
+    for (; queued < maxChunks && !dirtyQueue.empty(); ++queued)
+    {
+        const size_t i = dirtyQueue.front();
+        dirtyQueue.pop_front();
+        dirtyFlags[i] = 0;
+        // Edits only ever widen the storage; narrow it again now the chunk has settled
+        chunks[i]->compact();
+        // Copy the voxels here so later edits can't race the job
+        const Chunk &chunk = *chunks[i];
+        std::vector<uint8_t> volume(PADDED_SIZE * PADDED_SIZE * PADDED_SIZE);
+        const bool solid = gatherPaddedChunk(*this, chunk.chunkX, chunk.chunkY, chunk.chunkZ, volume.data());
+        const uint32_t version = ++meshVersions[i];
+        {
+            std::lock_guard<std::mutex> lock(meshMutex);
+            ++pendingMeshes;
+        }
+        jobs.submit([this, i, version, solid, volume = std::move(volume)]
+        {
+            MeshResult result{i, version, solid ? buildMesh(volume.data()) : std::make_unique<Mesh>()};
+            std::lock_guard<std::mutex> lock(meshMutex);
+            readyMeshes.push_back(std::move(result));
+            --pendingMeshes;
+        });
+    }
+    return queued;
+}
+
+void Asteroid::installMesh(size_t index, std::unique_ptr<Mesh> mesh)
+{
+    std::unique_ptr<Mesh> &slot = chunks[index]->mesh;
+    if (slot)
+    {
+        meshStats.vertices -= slot->vertices.size();
+        meshStats.indices -= slot->indices.size();
+        meshStats.faces -= slot->faces;
+    }
+    if (mesh)
+    {
+        meshStats.vertices += mesh->vertices.size();
+        meshStats.indices += mesh->indices.size();
+        meshStats.faces += mesh->faces;
+    }
+    slot = std::move(mesh);
+}
+
+std::vector<size_t> Asteroid::collectMeshes()
+{
+    std::vector<MeshResult> ready;
+    bool finished;
+    {
+        std::lock_guard<std::mutex> lock(meshMutex);
+        ready.swap(readyMeshes);
+        finished = pendingMeshes == 0;
+    }
+    std::vector<size_t> changed;
+    changed.reserve(ready.size());
+    for (MeshResult &result : ready)
+    {
+        // A newer job for this chunk was queued after this one
+        if (result.version != meshVersions[result.chunk])
+            continue;
+        installMesh(result.chunk, std::move(result.mesh));
+        changed.push_back(result.chunk);
+    }
+    if (finished && passInFlight)
+    {
+        passInFlight = false;
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - meshStart).count();
+        // One quad per exposed face is what the per-face mesher would have produced
+        const size_t faceVertices = meshStats.faces * 4;
+        printf("[Asteroid] meshed %zu chunks in %.1f ms (%u worker threads)\n", chunks.size(), ms,
+               DotBlue::GetJobSystem().getThreadCount());
+        printf("[Asteroid] %s meshing: %zu vertices, %zu indices (per-face: %zu vertices, %zu indices, %.1f%% fewer)\n",
+               greedyMeshing ? "greedy" : "per-face", meshStats.vertices, meshStats.indices, faceVertices,
+               meshStats.faces * 6, faceVertices ? 100.0 * (1.0 - (double)meshStats.vertices / faceVertices) : 0.0);
+    }
+    return changed;
+}
+
+double Asteroid::benchmarkMeshing(int passes) const
+{
+    passes = std::max(passes, 1);
+    MeshStats stats;
+    const auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass)
+        for (const auto &chunk : chunks)
+            buildChunkMesh(chunk->chunkX, chunk->chunkY, chunk->chunkZ, stats);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / passes;
+    printf("[Asteroid] meshing benchmark: %.2f ms per pass, %.1f us per chunk (%zu chunks, %d passes)\n", ms,
+           chunks.empty() ? 0.0 : ms * 1000.0 / chunks.size(), chunks.size(), passes);
+    return ms;
+}
+
+bool Asteroid::meshesPending() const
+{
+    std::lock_guard<std::mutex> lock(meshMutex);
+    return pendingMeshes > 0;
+}
+
+void Asteroid::waitForMeshes()
+{
+    // Only touch the job system when there is work, so this is safe after engine shutdown
+    while (meshesPending())
+    {
+        if (!DotBlue::GetJobSystem().runOne())
+            std::this_thread::yield();
+    }
+}
+
+// Atlas tile (and array layer) used for a voxel type
+static int voxelTile(VoxelType type)
+{
+    switch (type)
+    {
+    case VoxelType::Iron:
+        return 1;
+    case VoxelType::Ice:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+// Unit-cube corners of each face, CCW from outside: -X, +X, +Z, -Z, +Y, -Y. The face
+// order and the corner order (u runs from corner 0 to 1, v from 1 to 2) are mirrored by
+// the normal and UV tables in AsteroidRender's vertex shader.
+static const float faceVerts[6][12] = {
+    {0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 0, 0},
+    {1, 0, 0, 1, 1, 0, 1, 1, 1, 1, 0, 1},
+    {0, 0, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1},
+    {1, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 0},
+    {0, 1, 1, 1, 1, 1, 1, 1, 0, 0, 1, 0},
+    {0, 0, 0, 1, 0, 0, 1, 0, 1, 0, 0, 1}};
+static const int faceNormals[6][3] = {
+    {-1, 0, 0}, {1, 0, 0}, {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}};
+static const uint16_t quadIndices[6] = {0, 1, 2, 0, 2, 3};
+
+// Append one face quad spanning extent[a] voxels along each axis, starting at voxel (x, y, z)
+static void emitFace(Mesh &mesh, int face, int x, int y, int z, const int extent[3], int tile)
+{
+    const float *corners = faceVerts[face];
+    const int origin[3] = {x, y, z};
+    const size_t vertBase = mesh.vertices.size();
+    tile = std::min(tile, MESH_MAX_LAYER);
+    for (int i = 0; i < 4; ++i)
+    {
+        int p[3];
+        for (int a = 0; a < 3; ++a)
+            p[a] = origin[a] + (int)corners[i * 3 + a] * extent[a];
+        mesh.vertices.push_back(packVoxelVertex(p[0], p[1], p[2], face, tile));
+    }
+    for (int i = 0; i < 6; ++i)
+        mesh.indices.push_back(static_cast<uint16_t>(vertBase + quadIndices[i]));
 }
 
 void Asteroid::generateChunkMesh(int cx, int cy, int cz)
 {
-    Chunk *chunk = getChunk(cx, cy, cz);
-    if (!chunk)
+    const uint32_t index = chunkIndex(cx, cy, cz);
+    if (index == ChunkMap::NONE)
         return;
+    // Supersedes any job still building this chunk
+    ++meshVersions[index];
+    MeshStats stats;
+    installMesh(index, buildChunkMesh(cx, cy, cz, stats));
+}
+
+std::unique_ptr<Mesh> Asteroid::buildChunkMesh(int cx, int cy, int cz, MeshStats &stats) const
+{
+    if (!getChunk(cx, cy, cz))
+        return nullptr;
+    uint8_t volume[PADDED_SIZE * PADDED_SIZE * PADDED_SIZE];
+    std::unique_ptr<Mesh> mesh = gatherPaddedChunk(*this, cx, cy, cz, volume) ? buildMesh(volume)
+                                                                               : std::make_unique<Mesh>();
+    stats.vertices += mesh->vertices.size();
+    stats.indices += mesh->indices.size();
+    stats.faces += mesh->faces;
+    return mesh;
+}
+
+std::unique_ptr<Mesh> Asteroid::buildMesh(const uint8_t *volume) const
+{
     auto mesh = std::make_unique<Mesh>();
-    static const float faceVerts[6][12] = {
-        // -X (left): CCW from outside
-        {0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 0, 0},
-        // +X (right): CCW from outside
-        {1, 0, 0, 1, 1, 0, 1, 1, 1, 1, 0, 1},
-        // +Z (front): CCW from outside
-        {0, 0, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1},
-        // -Z (back): CCW from outside
-        {1, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 0},
-        // +Y (top): CCW from outside
-        {0, 1, 1, 1, 1, 1, 1, 1, 0, 0, 1, 0},
-        // -Y (bottom): CCW from outside
-        {0, 0, 0, 1, 0, 0, 1, 0, 1, 0, 0, 1}};
-    static const float faceNormals[6][3] = {
-        {-1, 0, 0}, {1, 0, 0}, {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}};
-    static const uint16_t quadIndices[6] = {0, 1, 2, 0, 2, 3};
-    // For now, always use the first tile (index 0) for stone faces
-    extern DotBlue::GLTextureAtlas *g_atlas_for_mesh; // must be set before calling generateChunkMesh
-    // We'll select the tile for each face (for now, always 0)
-    for (int z = 0; z < CHUNK_SIZE; ++z)
+
+    // Voxel type + 1 of the face at (u, v) in the current slice if it is exposed, else 0
+    uint8_t mask[CHUNK_SIZE][CHUNK_SIZE];
+    for (int face = 0; face < 6; ++face)
     {
-        for (int y = 0; y < CHUNK_SIZE; ++y)
+        // Slice along the normal's axis; u and v are the other two in x, y, z order
+        const int axis = faceNormals[face][0] ? 0 : (faceNormals[face][1] ? 1 : 2);
+        const int uAxis = axis == 0 ? 1 : 0;
+        const int vAxis = axis == 2 ? 1 : 2;
+        // The neighbour across the face is a fixed offset away in the padded volume
+        const int neighbour = faceNormals[face][axis] * PADDED_STRIDE[axis];
+        for (int slice = 0; slice < CHUNK_SIZE; ++slice)
         {
-            for (int x = 0; x < CHUNK_SIZE; ++x)
+            for (int u = 0; u < CHUNK_SIZE; ++u)
             {
-                Voxel &v = chunk->voxels[x][y][z];
-                if (v.type == VoxelType::Empty)
-                    continue;
-                for (int face = 0; face < 6; ++face)
+                const uint8_t *cell = volume + (slice + 1) * PADDED_STRIDE[axis] + (u + 1) * PADDED_STRIDE[uAxis] +
+                                      PADDED_STRIDE[vAxis];
+                for (int v = 0; v < CHUNK_SIZE; ++v, cell += PADDED_STRIDE[vAxis])
                 {
-                    int nx = x + (int)faceNormals[face][0];
-                    int ny = y + (int)faceNormals[face][1];
-                    int nz = z + (int)faceNormals[face][2];
-                    bool expose = true;
-                    if (nx >= 0 && nx < CHUNK_SIZE && ny >= 0 && ny < CHUNK_SIZE && nz >= 0 && nz < CHUNK_SIZE)
-                    {
-                        if (chunk->voxels[nx][ny][nz].type != VoxelType::Empty)
-                            expose = false;
-                    }
-                    else
+                    const uint8_t type = cell[0];
+                    const bool exposed = type != (uint8_t)VoxelType::Empty && cell[neighbour] == (uint8_t)VoxelType::Empty;
+                    mask[u][v] = exposed ? (uint8_t)(type + 1) : 0;
+                    mesh->faces += exposed;
+                }
+            }
+
+            // Merge equal mask cells into maximal rectangles: grow along v, then along u.
+            // Lighting only depends on the face direction, so the type is the whole key.
+            for (int u = 0; u < CHUNK_SIZE; ++u)
+            {
+                for (int v = 0; v < CHUNK_SIZE;)
+                {
+                    const int key = mask[u][v];
+                    if (key == 0)
                     {
-                        int wx = x + chunk->chunkX * CHUNK_SIZE + (int)faceNormals[face][0];
-                        int wy = y + chunk->chunkY * CHUNK_SIZE + (int)faceNormals[face][1];
-                        int wz = z + chunk->chunkZ * CHUNK_SIZE + (int)faceNormals[face][2];
-                        Voxel *nv = getVoxel(wx, wy, wz);
-                        if (nv && nv->type != VoxelType::Empty)
-                            expose = false;
+                        ++v;
+                        continue;
                     }
-                    if (expose)
+                    int height = 1;
+                    int width = 1;
+                    if (greedyMeshing)
                     {
-                        float u0 = 0, v0 = 0, u1 = 1, v1 = 1;
-                        if (g_atlas_for_mesh)
+                        while (v + height < CHUNK_SIZE && mask[u][v + height] == key)
+                            ++height;
+                        for (; u + width < CHUNK_SIZE; ++width)
                         {
-                            g_atlas_for_mesh->select(0); // Always select tile 0 for now
-                            g_atlas_for_mesh->getSelectedUVs(u0, v0, u1, v1);
+                            bool rowMatches = true;
+                            for (int k = 0; k < height && rowMatches; ++k)
+                                rowMatches = mask[u + width][v + k] == key;
+                            if (!rowMatches)
+                                break;
                         }
-                        size_t vertBase = mesh->vertices.size() / 8;
-                        for (int i = 0; i < 4; ++i)
-                        {
-                            float vx = x + faceVerts[face][i * 3 + 0];
-                            float vy = y + faceVerts[face][i * 3 + 1];
-                            float vz = z + faceVerts[face][i * 3 + 2];
-                            float nx = faceNormals[face][0];
-                            float ny = faceNormals[face][1];
-                            float nz = faceNormals[face][2];
-                            float u = (i == 0 || i == 3) ? u0 : u1;
-                            float v = (i < 2) ? v0 : v1;
-                            mesh->vertices.insert(mesh->vertices.end(), {vx, vy, vz, nx, ny, nz, u, v});
-                        }
-                        for (int i = 0; i < 6; ++i)
-                            mesh->indices.push_back(static_cast<uint16_t>(vertBase + quadIndices[i]));
                     }
+                    for (int du = 0; du < width; ++du)
+                        for (int dv = 0; dv < height; ++dv)
+                            mask[u + du][v + dv] = 0;
+
+                    int p[3], extent[3];
+                    p[axis] = slice;
+                    p[uAxis] = u;
+                    p[vAxis] = v;
+                    extent[axis] = 1;
+                    extent[uAxis] = width;
+                    extent[vAxis] = height;
+                    emitFace(*mesh, face, p[0], p[1], p[2], extent, voxelTile((VoxelType)(key - 1)));
+                    v += height;
                 }
             }
         }
     }
-    chunk->mesh = std::move(mesh);
+    return mesh;
 }
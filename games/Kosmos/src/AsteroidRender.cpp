@@ -4,165 +4,639 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <cstdio>
-struct GLMesh
+#include <algorithm>
+// Attribute locations of the packed voxel vertex and the per-draw chunk offset
+static GLint g_voxelAttrib = 0;
+static GLint g_offsetAttrib = 1;
+
+// Instance divisors (GL 3.3) and base-vertex draws (GL 3.2). Without them (GL 3.0 contexts)
+// each chunk is drawn with glDrawElements, the vertex pointer moved to the chunk's first
+// vertex and its offset set as a constant attribute.
+static bool instancedChunkDraws()
 {
-    GLuint vao = 0, vbo = 0, ebo = 0;
-    size_t indexCount = 0;
-    void upload(const Mesh &mesh)
+    return GLEW_VERSION_3_3 || (GLEW_ARB_instanced_arrays && GLEW_ARB_draw_elements_base_vertex);
+}
+
+// First-fit suballocator over [0, capacity) elements; free ranges stay sorted and merged
+struct RangeAllocator
+{
+    struct Range
     {
-        const char *glVer = (const char *)glGetString(GL_VERSION);
-        if (!glVer)
+        uint32_t offset, count;
+    };
+    std::vector<Range> freeRanges;
+    uint32_t capacity = 0;
+
+    bool allocate(uint32_t count, uint32_t &offset)
+    {
+        for (size_t i = 0; i < freeRanges.size(); ++i)
         {
-            std::cerr << "[GLMesh::upload] OpenGL context not current or not initialized!" << std::endl;
-            indexCount = 0;
+            Range &range = freeRanges[i];
+            if (range.count < count)
+                continue;
+            offset = range.offset;
+            range.offset += count;
+            range.count -= count;
+            if (range.count == 0)
+                freeRanges.erase(freeRanges.begin() + i);
+            return true;
+        }
+        return false;
+    }
+    void release(uint32_t offset, uint32_t count)
+    {
+        if (count == 0)
             return;
+        auto it = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset,
+                                   [](const Range &range, uint32_t value) { return range.offset < value; });
+        it = freeRanges.insert(it, Range{offset, count});
+        // Merge with the following range, then with the preceding one
+        auto next = it + 1;
+        if (next != freeRanges.end() && it->offset + it->count == next->offset)
+        {
+            it->count += next->count;
+            freeRanges.erase(next);
+        }
+        if (it != freeRanges.begin())
+        {
+            auto prev = it - 1;
+            if (prev->offset + prev->count == it->offset)
+            {
+                prev->count += it->count;
+                freeRanges.erase(it);
+            }
+        }
+    }
+    void grow(uint32_t newCapacity)
+    {
+        release(capacity, newCapacity - capacity);
+        capacity = newCapacity;
+    }
+};
+
+// One GL buffer suballocated between all chunks. Growing copies the old contents into a
+// larger buffer on the GPU, which changes the buffer name.
+struct ArenaBuffer
+{
+    GLuint buffer = 0;
+    size_t elementSize = 0;
+    RangeAllocator ranges;
+
+    bool allocate(uint32_t count, uint32_t &offset)
+    {
+        if (ranges.allocate(count, offset))
+            return true;
+        const uint32_t newCapacity = std::max(ranges.capacity * 2, ranges.capacity + std::max(count, 1u << 16));
+        GLuint grown = 0;
+        glGenBuffers(1, &grown);
+        if (!grown)
+        {
+            std::cerr << "[AsteroidRender] Failed to create arena buffer!" << std::endl;
+            return false;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)newCapacity * elementSize, nullptr, GL_STATIC_DRAW);
+        if (buffer)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                                (GLsizeiptr)ranges.capacity * elementSize);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glDeleteBuffers(1, &buffer);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        buffer = grown;
+        ranges.grow(newCapacity);
+        return ranges.allocate(count, offset);
+    }
+    void write(uint32_t offset, uint32_t count, const void *data)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)offset * elementSize, (GLsizeiptr)count * elementSize, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    void destroy()
+    {
+        if (buffer)
+            glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        ranges = RangeAllocator();
+    }
+};
+
+// Where a chunk's mesh lives in the arena. Indices stay chunk-relative (16 bit) and are
+// rebased with the draw's base vertex.
+struct ChunkDraw
+{
+    uint32_t firstVertex = 0, vertexCount = 0;
+    uint32_t firstIndex = 0, indexCount = 0;
+};
+
+// Layout of GL_DRAW_INDIRECT_BUFFER entries for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance; // Chunk index: selects the chunk's entry in the offset buffer
+};
+
+// All chunk geometry: vertex and index arenas, the per-chunk offset buffer (one vec3 per
+// chunk, read as an instanced attribute) and the VAO tying them together
+struct ChunkArena
+{
+    ArenaBuffer vertices, indices;
+    GLuint offsetBuffer = 0, indirectBuffer = 0, vao = 0;
+    std::vector<ChunkDraw> draws;
+    bool layoutDirty = true; // Buffers were replaced; re-point the VAO
+
+    ChunkArena()
+    {
+        vertices.elementSize = sizeof(uint32_t);
+        indices.elementSize = sizeof(uint16_t);
+    }
+    ~ChunkArena() { destroy(); }
+
+    void reset(const Asteroid &asteroid)
+    {
+        destroy();
+        draws.assign(asteroid.chunks.size(), ChunkDraw());
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &offsetBuffer);
+        glGenBuffers(1, &indirectBuffer);
+        uploadOffsets(asteroid);
+        layoutDirty = true;
+    }
+    // Chunks were appended (an edit reached unallocated space); existing draws stay put
+    void grow(const Asteroid &asteroid)
+    {
+        draws.resize(asteroid.chunks.size());
+        uploadOffsets(asteroid);
+    }
+    void uploadOffsets(const Asteroid &asteroid)
+    {
+        std::vector<float> offsets;
+        offsets.reserve(asteroid.chunks.size() * 3);
+        for (const auto &chunk : asteroid.chunks)
+        {
+            offsets.push_back(float(chunk->chunkX * CHUNK_SIZE));
+            offsets.push_back(float(chunk->chunkY * CHUNK_SIZE));
+            offsets.push_back(float(chunk->chunkZ * CHUNK_SIZE));
         }
-        if (mesh.vertices.empty() || mesh.indices.empty())
+        // Same buffer name, so the VAO's binding stays valid
+        glBindBuffer(GL_ARRAY_BUFFER, offsetBuffer);
+        glBufferData(GL_ARRAY_BUFFER, offsets.size() * sizeof(float), offsets.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    void upload(size_t chunk, const Mesh *mesh)
+    {
+        ChunkDraw &draw = draws[chunk];
+        vertices.ranges.release(draw.firstVertex, draw.vertexCount);
+        indices.ranges.release(draw.firstIndex, draw.indexCount);
+        draw = ChunkDraw();
+        if (!mesh || mesh->vertices.empty() || mesh->indices.empty())
+            return;
+        const uint32_t vertexCount = (uint32_t)mesh->vertices.size();
+        const uint32_t indexCount = (uint32_t)mesh->indices.size();
+        const GLuint oldVertices = vertices.buffer, oldIndices = indices.buffer;
+        if (!vertices.allocate(vertexCount, draw.firstVertex))
         {
-            indexCount = 0;
+            draw = ChunkDraw();
             return;
         }
-        if (!vao)
-            glGenVertexArrays(1, &vao);
-        if (!vbo)
-            glGenBuffers(1, &vbo);
-        if (!ebo)
-            glGenBuffers(1, &ebo);
-        if (vao == 0 || vbo == 0 || ebo == 0)
+        if (!indices.allocate(indexCount, draw.firstIndex))
         {
-            std::cerr << "[GLMesh::upload] Failed to create VAO/VBO/EBO! vao=" << vao << " vbo=" << vbo << " ebo=" << ebo << std::endl;
-            indexCount = 0;
+            // The vertex buffer may have grown already
+            vertices.ranges.release(draw.firstVertex, vertexCount);
+            layoutDirty |= vertices.buffer != oldVertices;
+            draw = ChunkDraw();
             return;
         }
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(uint16_t), mesh.indices.data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0); // pos
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(1); // normal
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2); // uv
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
-        indexCount = mesh.indices.size();
-        glBindVertexArray(0); // Unbind VAO to prevent state leakage
+        layoutDirty |= vertices.buffer != oldVertices || indices.buffer != oldIndices;
+        vertices.write(draw.firstVertex, vertexCount, mesh->vertices.data());
+        indices.write(draw.firstIndex, indexCount, mesh->indices.data());
+        draw.vertexCount = vertexCount;
+        draw.indexCount = indexCount;
     }
-    void destroy()
+    // Bind the VAO, re-pointing it first if a buffer was replaced
+    void bind()
     {
-        if (vbo)
+        glBindVertexArray(vao);
+        if (!layoutDirty)
+            return;
+        glBindBuffer(GL_ARRAY_BUFFER, vertices.buffer);
+        glEnableVertexAttribArray(g_voxelAttrib);
+        // One integer attribute; the shader unpacks it
+        glVertexAttribIPointer(g_voxelAttrib, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void *)0);
+        if (instancedChunkDraws())
         {
-            glDeleteBuffers(1, &vbo);
-            vbo = 0;
+            pointOffsets(0);
+            glEnableVertexAttribArray(g_offsetAttrib);
+            glVertexAttribDivisor(g_offsetAttrib, 1);
         }
-        if (ebo)
+        else
         {
-            glDeleteBuffers(1, &ebo);
-            ebo = 0;
+            // Read as a constant, set per draw with glVertexAttrib3f
+            glDisableVertexAttribArray(g_offsetAttrib);
         }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.buffer);
+        layoutDirty = false;
+    }
+    // Start the vertex attribute at a chunk's first vertex (for draws without a base vertex)
+    void pointVertices(uint32_t firstVertex)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, vertices.buffer);
+        glVertexAttribIPointer(g_voxelAttrib, 1, GL_UNSIGNED_INT, sizeof(uint32_t),
+                               (void *)(firstVertex * sizeof(uint32_t)));
+    }
+    // Point the offset attribute at a chunk's entry (for draws without a base instance)
+    void pointOffsets(size_t chunk)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, offsetBuffer);
+        glVertexAttribPointer(g_offsetAttrib, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
+                              (void *)(chunk * 3 * sizeof(float)));
+    }
+    void destroy()
+    {
+        vertices.destroy();
+        indices.destroy();
+        if (offsetBuffer)
+            glDeleteBuffers(1, &offsetBuffer);
+        if (indirectBuffer)
+            glDeleteBuffers(1, &indirectBuffer);
         if (vao)
-        {
             glDeleteVertexArrays(1, &vao);
-            vao = 0;
-        }
-        indexCount = 0;
+        offsetBuffer = indirectBuffer = vao = 0;
+        draws.clear();
+        layoutDirty = true;
     }
-    ~GLMesh() { destroy(); }
 };
 
-// Minimal shader sources
+// Minimal shader sources (the fragment shader gets a #version/#define header, see render())
 static const char *voxelVertShader = R"(
 #version 130
 uniform mat4 u_mvp;
-uniform vec3 u_chunkOffset;
-in vec3 a_pos;
-in vec3 a_normal;
-in vec2 a_uv;
+in uint a_packed;       // x:5 y:5 z:5 face:3 layer:14, see packVoxelVertex()
+in vec3 a_chunkOffset; // Per draw (instanced), from the chunk offset buffer
 out vec3 v_normal;
 out vec2 v_uv;
+flat out float v_layer;
+// Per face (-X, +X, +Z, -Z, +Y, -Y): normal and the directions u and v run along
+const vec3 normals[6] = vec3[6](vec3(-1, 0, 0), vec3(1, 0, 0), vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, 1, 0), vec3(0, -1, 0));
+const vec3 uDirs[6] = vec3[6](vec3(0, 1, 0), vec3(0, 1, 0), vec3(1, 0, 0), vec3(-1, 0, 0), vec3(1, 0, 0), vec3(1, 0, 0));
+const vec3 vDirs[6] = vec3[6](vec3(0, 0, -1), vec3(0, 0, 1), vec3(0, 1, 0), vec3(0, 1, 0), vec3(0, 0, -1), vec3(0, 0, 1));
 void main() {
-    gl_Position = u_mvp * vec4(a_pos + u_chunkOffset, 1.0);
-    v_normal = a_normal;
-    v_uv = a_uv;
+    vec3 pos = vec3(float(a_packed & 31u), float((a_packed >> 5u) & 31u), float((a_packed >> 10u) & 31u));
+    int face = int((a_packed >> 15u) & 7u);
+    gl_Position = u_mvp * vec4(pos + a_chunkOffset, 1.0);
+    v_normal = normals[face];
+    // UVs in voxels; only their fractional part matters, so any integer offset is fine
+    v_uv = vec2(dot(pos, uDirs[face]), dot(pos, vDirs[face]));
+    v_layer = float(a_packed >> 18u);
 }
 )";
 static const char *voxelFragShader = R"(
-#version 130
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray u_tex;
+#else
 uniform sampler2D u_tex;
+uniform vec2 u_atlasGrid; // Tile columns, rows
+#endif
 uniform vec3 u_lightDir;
 uniform float u_ambient;
 in vec3 v_normal;
 in vec2 v_uv;
+flat in float v_layer;
 out vec4 fragColor;
 void main() {
     vec3 normal = normalize(v_normal);
     float diff = max(dot(normal, normalize(u_lightDir)), 0.0);
     float lighting = u_ambient + (1.0 - u_ambient) * diff;
-    vec4 tex = texture(u_tex, v_uv);
+#ifdef TEXTURE_ARRAY
+    vec4 tex = texture(u_tex, vec3(v_uv, v_layer));
+#else
+    // Wrap inside the tile by hand; gradients come from the unwrapped UVs so the fract()
+    // seam does not pick a tiny mip
+    vec2 tile = vec2(mod(v_layer, u_atlasGrid.x), floor(v_layer / u_atlasGrid.x));
+    vec2 uv = (tile + fract(v_uv)) / u_atlasGrid;
+    vec4 tex = textureGrad(u_tex, uv, dFdx(v_uv) / u_atlasGrid, dFdy(v_uv) / u_atlasGrid);
+#endif
     fragColor = vec4(tex.rgb * lighting, tex.a);
 }
 )";
 
-void AsteroidRender::render(const Asteroid &asteroid, const DotBlue::GLTextureAtlas &atlas, const glm::dmat4 &viewProj, const glm::vec3 &lightDir)
+// Chunk bounds for occlusion queries: a unit cube scaled by u_boxSize. Only depth testing
+// matters, the colour is masked off.
+static const char *boxVertShader = R"(
+#version 130
+uniform mat4 u_mvp;
+uniform vec3 u_boxMin;
+uniform vec3 u_boxSize;
+in vec3 a_corner;
+void main() {
+    gl_Position = u_mvp * vec4(u_boxMin + a_corner * u_boxSize, 1.0);
+}
+)";
+static const char *boxFragShader = R"(
+#version 130
+out vec4 fragColor;
+void main() {
+    fragColor = vec4(1.0);
+}
+)";
+
+// Occlusion state of one chunk. A query wraps the chunk's draw while it is visible, or its
+// bounding box while it is hidden; the result is read a frame later, never waited on.
+struct ChunkOcclusion
+{
+    GLuint query = 0;
+    bool pending = false;  // Issued, result not read yet
+    bool occluded = false; // Last read result found no samples
+};
+
+static AsteroidRender::Stats g_renderStats;
+static bool g_occlusionCulling = true;
+
+const AsteroidRender::Stats &AsteroidRender::getStats()
+{
+    return g_renderStats;
+}
+
+void AsteroidRender::setOcclusionCulling(bool enabled)
+{
+    g_occlusionCulling = enabled;
+}
+
+bool AsteroidRender::getOcclusionCulling()
 {
-    static std::vector<GLMesh> glMeshes;
+    return g_occlusionCulling;
+}
+
+void AsteroidRender::render(Asteroid &asteroid, const DotBlue::GLTextureAtlas &atlas, const glm::dmat4 &viewProj, const glm::vec3 &lightDir)
+{
+    static ChunkArena arena;
+    static uint64_t arenaAsteroid = 0; // Asteroid::getId() of the chunks in the arena
+    static DotBlue::GLBoundsBatch chunkBounds; // World-space chunk boxes, same order as the chunks
+    static std::vector<uint8_t> chunkVisible;
+    static std::vector<ChunkOcclusion> occlusion;
+    static std::vector<DrawElementsIndirectCommand> commands;
     static DotBlue::GLShader shader;
+    static DotBlue::GLShader::Uniform u_mvp, u_lightDir, u_ambient, u_tex, u_atlasGrid;
+    static DotBlue::GLShader boxShader;
+    static DotBlue::GLShader::Uniform u_boxMvp, u_boxMin, u_boxSize;
+    static GLuint boxVao = 0, boxVbo = 0, boxEbo = 0;
+    static GLenum queryTarget = 0; // 0 when occlusion queries are unavailable
     static bool shaderLoaded = false;
+    static bool shaderArray = false;
+    if (shaderLoaded && shaderArray != atlas.isArrayTexture())
+        shaderLoaded = false;
     if (!shaderLoaded)
     {
-        shaderLoaded = shader.load(voxelVertShader, voxelFragShader);
+        shaderArray = atlas.isArrayTexture();
+        std::string fragSource = std::string("#version 130\n") + (shaderArray ? "#define TEXTURE_ARRAY\n" : "") +
+                                 voxelFragShader;
+        shaderLoaded = shader.load(voxelVertShader, fragSource);
         if (!shaderLoaded)
         {
             std::cerr << "[AsteroidRender] Shader failed to load!" << std::endl;
             return;
         }
+        u_mvp = shader.getUniform("u_mvp");
+        u_lightDir = shader.getUniform("u_lightDir");
+        u_ambient = shader.getUniform("u_ambient");
+        u_tex = shader.getUniform("u_tex");
+        u_atlasGrid = shader.getUniform("u_atlasGrid");
+        g_voxelAttrib = glGetAttribLocation(shader.getProgram(), "a_packed");
+        g_offsetAttrib = glGetAttribLocation(shader.getProgram(), "a_chunkOffset");
+        // Any-samples queries let the driver stop counting at the first passing sample
+        if (GLEW_VERSION_3_3 || GLEW_ARB_occlusion_query2)
+            queryTarget = GL_ANY_SAMPLES_PASSED;
+        else
+            queryTarget = GL_SAMPLES_PASSED;
+        if (!boxVao && boxShader.load(boxVertShader, boxFragShader))
+        {
+            u_boxMvp = boxShader.getUniform("u_mvp");
+            u_boxMin = boxShader.getUniform("u_boxMin");
+            u_boxSize = boxShader.getUniform("u_boxSize");
+            static const float corners[8 * 3] = {0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 0, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1};
+            // Winding is irrelevant, face culling is off while boxes are drawn
+            static const GLubyte boxIndices[36] = {0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4,
+                                                   3, 2, 6, 3, 6, 7, 0, 3, 7, 0, 7, 4, 1, 2, 6, 1, 6, 5};
+            glGenVertexArrays(1, &boxVao);
+            glGenBuffers(1, &boxVbo);
+            glGenBuffers(1, &boxEbo);
+            glBindVertexArray(boxVao);
+            glBindBuffer(GL_ARRAY_BUFFER, boxVbo);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxEbo);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(boxIndices), boxIndices, GL_STATIC_DRAW);
+            const GLint cornerAttrib = glGetAttribLocation(boxShader.getProgram(), "a_corner");
+            glEnableVertexAttribArray(cornerAttrib);
+            glVertexAttribPointer(cornerAttrib, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+            glBindVertexArray(0);
+        }
+        if (!boxVao)
+        {
+            std::cerr << "[AsteroidRender] Occlusion box shader failed to load, occlusion culling disabled" << std::endl;
+            queryTarget = 0;
+        }
+        // The VAO points at the previous program's attribute locations
+        arena.layoutDirty = true;
     }
-    if (glMeshes.size() != asteroid.chunks.size())
+    // Install meshes the workers finished since the last frame; only those need uploading
+    std::vector<size_t> changed = asteroid.collectMeshes();
+    // The chunk list only grows while an asteroid lives, so only a different asteroid needs
+    // a full rebuild
+    if (arenaAsteroid != asteroid.getId())
     {
-        for (auto &m : glMeshes)
-            m.destroy();
-        glMeshes.clear();
-        glMeshes.resize(asteroid.chunks.size());
+        arenaAsteroid = asteroid.getId();
+        arena.reset(asteroid);
+        for (ChunkOcclusion &occ : occlusion)
+        {
+            if (occ.query)
+                glDeleteQueries(1, &occ.query);
+        }
+        occlusion.clear();
+        chunkBounds.clear();
+        changed.clear();
         for (size_t i = 0; i < asteroid.chunks.size(); ++i)
+            changed.push_back(i);
+    }
+    else if (asteroid.chunks.size() > arena.draws.size())
+    {
+        arena.grow(asteroid);
+    }
+    occlusion.resize(asteroid.chunks.size());
+    for (size_t i = chunkBounds.size(); i < asteroid.chunks.size(); ++i)
+    {
+        const Chunk &chunk = *asteroid.chunks[i];
+        const glm::dvec3 chunkMin(chunk.chunkX * CHUNK_SIZE, chunk.chunkY * CHUNK_SIZE, chunk.chunkZ * CHUNK_SIZE);
+        chunkBounds.addBox(chunkMin, chunkMin + glm::dvec3(CHUNK_SIZE));
+    }
+    for (size_t i : changed)
+        arena.upload(i, asteroid.chunks[i]->mesh.get());
+    // Skip chunks outside the view before touching any GL state for them
+    g_renderStats = AsteroidRender::Stats();
+    g_renderStats.chunks = asteroid.chunks.size();
+    g_renderStats.inFrustum = DotBlue::GLFrustum::fromMatrix(viewProj).cullBoxes(chunkBounds, chunkVisible);
+
+    const bool occlusionOn = g_occlusionCulling && queryTarget != 0;
+    // Near-plane centre, to keep the chunks around the camera out of occlusion tests: their
+    // boxes would be clipped by the near plane and could report no samples
+    const glm::dvec4 eye = glm::inverse(viewProj) * glm::dvec4(0.0, 0.0, -1.0, 1.0);
+    const glm::dvec3 eyePos = glm::dvec3(eye) / eye.w;
+
+    // Read last frame's results where they are ready, and split the chunks in view into
+    // ones to draw normally and ones to test against the depth buffer first
+    std::vector<size_t> visibleChunks, hiddenChunks;
+    for (size_t i = 0; i < asteroid.chunks.size(); ++i)
+    {
+        if (!chunkVisible[i] || arena.draws[i].indexCount == 0)
+            continue;
+        ChunkOcclusion &occ = occlusion[i];
+        if (occ.pending)
         {
-            if (asteroid.chunks[i]->mesh)
-                glMeshes[i].upload(*asteroid.chunks[i]->mesh);
+            GLuint available = 0;
+            glGetQueryObjectuiv(occ.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint samples = 0;
+                glGetQueryObjectuiv(occ.query, GL_QUERY_RESULT, &samples);
+                occ.occluded = samples == 0;
+                occ.pending = false;
+            }
         }
+        const Chunk &chunk = *asteroid.chunks[i];
+        const glm::dvec3 chunkMin(chunk.chunkX * CHUNK_SIZE, chunk.chunkY * CHUNK_SIZE, chunk.chunkZ * CHUNK_SIZE);
+        bool nearEye = true;
+        for (int a = 0; a < 3; ++a)
+            nearEye = nearEye && eyePos[a] >= chunkMin[a] - 1.0 && eyePos[a] <= chunkMin[a] + CHUNK_SIZE + 1.0;
+        if (!occlusionOn || nearEye)
+            occ.occluded = false;
+        (occ.occluded ? hiddenChunks : visibleChunks).push_back(i);
     }
+    g_renderStats.occluded = hiddenChunks.size();
+
+    // With base instances the offset buffer stays put and each draw picks its chunk's entry;
+    // without, the attribute is re-pointed per draw (the VAO must be bound)
+    const bool instanced = instancedChunkDraws();
+    const bool baseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+    auto drawChunk = [&](size_t i)
+    {
+        const ChunkDraw &draw = arena.draws[i];
+        const void *indexOffset = (const void *)(draw.firstIndex * sizeof(uint16_t));
+        if (baseInstance)
+        {
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, (GLsizei)draw.indexCount, GL_UNSIGNED_SHORT,
+                                                          indexOffset, 1, (GLint)draw.firstVertex, (GLuint)i);
+        }
+        else if (instanced)
+        {
+            arena.pointOffsets(i);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)draw.indexCount, GL_UNSIGNED_SHORT, indexOffset, 1,
+                                              (GLint)draw.firstVertex);
+        }
+        else
+        {
+            const Chunk &chunk = *asteroid.chunks[i];
+            arena.pointVertices(draw.firstVertex);
+            glVertexAttrib3f(g_offsetAttrib, float(chunk.chunkX * CHUNK_SIZE), float(chunk.chunkY * CHUNK_SIZE),
+                             float(chunk.chunkZ * CHUNK_SIZE));
+            glDrawElements(GL_TRIANGLES, (GLsizei)draw.indexCount, GL_UNSIGNED_SHORT, indexOffset);
+        }
+        ++g_renderStats.drawCalls;
+    };
+
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
     shader.bind();
-    shader.setMat4("u_mvp", glm::mat4(viewProj));
-    shader.setVec3("u_lightDir", lightDir.x, lightDir.y, lightDir.z);
-    shader.setFloat("u_ambient", 0.45f);
+    shader.setMat4(u_mvp, glm::mat4(viewProj));
+    shader.setVec3(u_lightDir, lightDir);
+    shader.setFloat(u_ambient, 0.45f);
     atlas.bind();
-    shader.setInt("u_tex", 0);
-    for (size_t i = 0; i < asteroid.chunks.size(); ++i)
+    shader.setInt(u_tex, 0);
+    if (u_atlasGrid.isValid())
+        shader.setVec2(u_atlasGrid, glm::vec2((float)atlas.getColumns(), (float)atlas.getRows()));
+    arena.bind();
+    // Visible chunks: one multi-draw when indirect draws are available
+    g_renderStats.drawn = visibleChunks.size();
+    const bool multiDrawIndirect = GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && baseInstance);
+    if (multiDrawIndirect && !visibleChunks.empty())
     {
-        const Chunk &chunk = *asteroid.chunks[i];
-        const GLMesh &mesh = glMeshes[i];
-        if (mesh.indexCount == 0 || mesh.vao == 0 || mesh.vbo == 0 || mesh.ebo == 0)
-            continue;
-        float offsetX = float(chunk.chunkX * CHUNK_SIZE);
-        float offsetY = float(chunk.chunkY * CHUNK_SIZE);
-        float offsetZ = float(chunk.chunkZ * CHUNK_SIZE);
-        shader.setVec3("u_chunkOffset", offsetX, offsetY, offsetZ);
-        if (i == 11)
-        {
-            const Chunk &debugChunk = *asteroid.chunks[i];
-            if (debugChunk.mesh)
+        commands.clear();
+        for (size_t i : visibleChunks)
+        {
+            const ChunkDraw &draw = arena.draws[i];
+            commands.push_back({draw.indexCount, 1, draw.firstIndex, (GLint)draw.firstVertex, (GLuint)i});
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, arena.indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(),
+                     GL_STREAM_DRAW);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, nullptr, (GLsizei)commands.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        ++g_renderStats.drawCalls;
+    }
+    else
+    {
+        for (size_t i : visibleChunks)
+            drawChunk(i);
+    }
+    if (occlusionOn)
+    {
+        // Test chunk bounds against the depth of everything drawn above: visible chunks to
+        // find out whether they still are, hidden ones to decide whether to draw them now
+        shader.unbind();
+        boxShader.bind();
+        boxShader.setMat4(u_boxMvp, glm::mat4(viewProj));
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_CULL_FACE);
+        glBindVertexArray(boxVao);
+        for (const std::vector<size_t> *list : {&visibleChunks, &hiddenChunks})
+        {
+            for (size_t i : *list)
             {
+                ChunkOcclusion &occ = occlusion[i];
+                if (occ.pending)
+                    continue;
+                if (!occ.query)
+                    glGenQueries(1, &occ.query);
+                const Chunk &chunk = *asteroid.chunks[i];
+                // Grown slightly so faces on the chunk border don't tie with the depth buffer
+                const glm::vec3 boxMin(chunk.chunkX * CHUNK_SIZE - 0.05f, chunk.chunkY * CHUNK_SIZE - 0.05f,
+                                       chunk.chunkZ * CHUNK_SIZE - 0.05f);
+                boxShader.setVec3(u_boxMin, boxMin);
+                boxShader.setVec3(u_boxSize, glm::vec3(CHUNK_SIZE + 0.1f));
+                glBeginQuery(queryTarget, occ.query);
+                glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, 0);
+                glEndQuery(queryTarget);
+                occ.pending = true;
             }
         }
-        if (mesh.vao == 0 || mesh.vbo == 0 || mesh.ebo == 0)
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_TRUE);
+        glEnable(GL_CULL_FACE);
+        boxShader.unbind();
+
+        // Draw hidden chunks only if the box test passed. QUERY_NO_WAIT draws anyway when
+        // the GPU has no result yet, so chunks coming into view show up in the same frame.
+        if (GLEW_VERSION_3_0 && !hiddenChunks.empty())
         {
-            continue;
+            shader.bind();
+            arena.bind();
+            for (size_t i : hiddenChunks)
+            {
+                glBeginConditionalRender(occlusion[i].query, GL_QUERY_NO_WAIT);
+                drawChunk(i);
+                glEndConditionalRender();
+            }
         }
-        glBindVertexArray(mesh.vao);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount), GL_UNSIGNED_SHORT, 0);
     }
+    glBindVertexArray(0);
     // Unbind shader and texture to avoid affecting subsequent rendering
     shader.unbind();
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(shaderArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, 0);
 }
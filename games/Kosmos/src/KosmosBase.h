@@ -9,16 +9,29 @@
 
 #include <DotBlue/DotBlue.h>
 #include <atomic>
+#include <mutex>
+#include <chrono>
 #include <string>
 #include <map>
+#include <deque>
 #include <vector>
 #include <cstdint>
 #include <random>
 
+// Packed chunk mesh vertex (4 bytes): chunk-local x, y, z in 5 bits each (0..16), the
+// face index (0..5, selects the normal) in 3 bits and the atlas tile/layer in the top 14.
+// The vertex shader rebuilds the normal and derives UVs from the position, in voxels, so
+// the tile repeats once per voxel and merged faces keep the texel density of single ones.
+constexpr int MESH_MAX_LAYER = (1 << 14) - 1;
+inline uint32_t packVoxelVertex(int x, int y, int z, int face, int layer)
+{
+    return (uint32_t)x | (uint32_t)y << 5 | (uint32_t)z << 10 | (uint32_t)face << 15 | (uint32_t)layer << 18;
+}
 struct Mesh
 {
-    std::vector<float> vertices;
+    std::vector<uint32_t> vertices;
     std::vector<uint16_t> indices;
+    size_t faces = 0; // Exposed voxel faces it covers
 };
 
 class Camera
@@ -121,39 +134,197 @@ struct Voxel
     uint8_t data;
     Voxel() : type(VoxelType::Empty), data(0) {}
     Voxel(VoxelType t, uint8_t d = 0) : type(t), data(d) {}
+    bool operator==(const Voxel &other) const { return type == other.type && data == other.data; }
+    bool operator!=(const Voxel &other) const { return !(*this == other); }
 };
 
-constexpr int CHUNK_SIZE = 16;
+constexpr int CHUNK_SHIFT = 4; // log2(CHUNK_SIZE)
+constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+constexpr int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+// Voxel storage of one chunk. Most asteroid chunks are all empty or all stone, so a chunk
+// is kept as the cheapest of:
+//   Uniform - one voxel value for the whole chunk (no per-voxel data)
+//   Palette - the distinct voxels plus 1, 2, 4 or 8 bit indices packed into 64-bit words
+//   Dense   - a plain Voxel array, once the palette would need more than 8 bits
+// Voxels are addressed [x][y][z], z fastest. Edits widen the storage as needed; compact()
+// narrows it again (the palette keeps values that were overwritten until then).
 class Chunk
 {
 public:
-    Voxel voxels[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
+    enum class Storage : uint8_t
+    {
+        Uniform,
+        Palette,
+        Dense,
+    };
+
     int chunkX, chunkY, chunkZ;
     std::unique_ptr<Mesh> mesh;
     Chunk(int x, int y, int z);
-    Voxel &getVoxel(int x, int y, int z);
+    Voxel getVoxel(int x, int y, int z) const;
     void setVoxel(int x, int y, int z, VoxelType type, uint8_t data = 0);
+    // Replace every voxel from a dense [x][y][z] array, picking the smallest storage
+    void assign(const Voxel *voxels);
+    // Rebuild the palette from the voxels still in use and pick the smallest storage
+    void compact();
+    // Decode all voxel types into CHUNK_VOLUME bytes, [x][y][z] (meshing fast path)
+    void decodeTypes(uint8_t *types) const;
+    VoxelType getType(int x, int y, int z) const;
+    bool isUniform() const { return storage == Storage::Uniform; }
+    Storage getStorage() const { return storage; }
+    size_t memoryBytes() const; // Heap and object bytes used for the voxels
+
+private:
+    Storage storage = Storage::Uniform;
+    std::vector<Voxel> palette; // palette[0] is the uniform value
+    std::vector<uint64_t> packed;
+    int bits = 0; // Bits per packed index
+    std::unique_ptr<Voxel[]> dense;
+
+    static int index(int x, int y, int z) { return (x * CHUNK_SIZE + y) * CHUNK_SIZE + z; }
+    uint32_t paletteIndex(int i) const;
+    void setPaletteIndex(int i, uint32_t value);
+    void store(const Voxel *voxels, std::vector<Voxel> newPalette);
+    void toDense();
+};
+
+// Open-addressing hash table from chunk coordinates to indices into Asteroid::chunks.
+// Linear probing over one flat slot array keeps a lookup within a cache line or two.
+// Coordinates are packed into 21 signed bits per axis (about +-1M chunks); entries are
+// never removed.
+class ChunkMap
+{
+public:
+    static constexpr uint32_t NONE = 0xffffffffu;
+    static uint64_t key(int cx, int cy, int cz)
+    {
+        return (uint64_t)(cx & 0x1fffff) | (uint64_t)(cy & 0x1fffff) << 21 | (uint64_t)(cz & 0x1fffff) << 42;
+    }
+    uint32_t find(uint64_t key) const; // NONE if absent
+    void insert(uint64_t key, uint32_t value);
+    size_t size() const { return count; }
+
+private:
+    struct Slot
+    {
+        uint64_t key;
+        uint32_t value; // NONE marks an empty slot
+    };
+    std::vector<Slot> slots; // Power-of-two size, at most half full
+    size_t count = 0;
+    static size_t hash(uint64_t key);
 };
 
-constexpr int MIN_CHUNKS = 4;
-constexpr int MAX_CHUNKS = 32;
 class Asteroid
 {
 public:
-    int dimX, dimY, dimZ;
+    // Totals over every chunk mesh built by generate()
+    struct MeshStats
+    {
+        size_t vertices = 0;
+        size_t indices = 0;
+        size_t faces = 0; // Exposed voxel faces (one quad each without greedy meshing)
+    };
+
+    // The world is sparse and unbounded (within ChunkMap's range, negative coordinates
+    // included): only chunks holding solid voxels are allocated, everything else reads as
+    // Empty. chunks is append-only, so a chunk's index (used for meshes, dirty flags and
+    // render state) never changes.
+    int dimX, dimY, dimZ; // Size of the generated field in chunks
     std::vector<std::unique_ptr<Chunk>> chunks;
-    Asteroid(int dx, int dy, int dz, uint32_t seed);
+    bool greedyMeshing; // Merge coplanar same-type faces into rectangles
+    MeshStats meshStats;
+    Asteroid(int dx, int dy, int dz, uint32_t seed, bool greedy = true);
+    ~Asteroid(); // Waits for outstanding mesh jobs
+    // Unique per asteroid for the life of the process (never 0)
+    uint64_t getId() const { return id; }
     Chunk *getChunk(int cx, int cy, int cz);
-    Voxel *getVoxel(int wx, int wy, int wz);
+    const Chunk *getChunk(int cx, int cy, int cz) const;
+    // Empty where no chunk is allocated. Remembers the last chunk per thread, so walking
+    // nearby voxels skips the hash lookup.
+    Voxel getVoxel(int wx, int wy, int wz) const;
+    // Allocates the chunk if needed. Marks it, and neighbours sharing the changed voxel's
+    // border, for remeshing.
     void setVoxel(int wx, int wy, int wz, VoxelType type, uint8_t data = 0);
+    // Fills a dimX x dimY x dimZ chunk field, keeping only non-empty chunks, and queues
+    // every chunk for meshing; meshes arrive via collectMeshes()
     void generate(uint32_t seed);
+    // Mesh one chunk on the calling thread and install it immediately
     void generateChunkMesh(int cx, int cy, int cz);
+    // Build a chunk's mesh without modifying the asteroid, so it can run on a worker
+    std::unique_ptr<Mesh> buildChunkMesh(int cx, int cy, int cz, MeshStats &stats) const;
+    // Voxel storage totals over all chunks (see Chunk)
+    struct StorageStats
+    {
+        size_t uniformChunks = 0, paletteChunks = 0, denseChunks = 0;
+        size_t bytes = 0;      // Memory used by chunk voxel storage
+        size_t denseBytes = 0; // What plain Voxel arrays would use
+    };
+    StorageStats storageStats() const;
+
+    // Mesh every chunk serially on the calling thread, passes times, discarding the
+    // results; returns the average milliseconds per pass and prints the timings
+    double benchmarkMeshing(int passes) const;
+
+    // Mesh all chunks on the DotBlue job system. The jobs read the live voxels, so
+    // setVoxel() first waits for this pass to finish.
+    void meshAllChunks();
+    // Snapshot up to maxChunks dirty chunks (oldest edits first) and remesh them in the
+    // background; returns how many were queued. Call once per frame.
+    size_t remeshDirtyChunks(size_t maxChunks);
+    size_t dirtyChunkCount() const { return dirtyQueue.size(); }
+    // Render thread: install finished meshes; returns the indices of chunks that got one
+    std::vector<size_t> collectMeshes();
+    bool meshesPending() const;
+    void waitForMeshes(); // Helps run the jobs until all meshes are built
+
+private:
+    struct MeshResult
+    {
+        size_t chunk;
+        uint32_t version;
+        std::unique_ptr<Mesh> mesh;
+    };
+    mutable std::mutex meshMutex; // Guards readyMeshes and pendingMeshes
+    std::vector<MeshResult> readyMeshes;
+    size_t pendingMeshes = 0;
+    // Render thread only
+    std::vector<uint32_t> meshVersions; // Latest job per chunk; older results are dropped
+    std::vector<uint8_t> dirtyFlags;
+    std::deque<size_t> dirtyQueue;
+    bool passInFlight = false; // meshAllChunks() jobs may still be reading voxels
+    std::chrono::steady_clock::time_point meshStart;
+
+    ChunkMap chunkMap;
+    uint64_t id; // Distinguishes asteroids in the per-thread getVoxel() cache
+
+    uint32_t chunkIndex(int cx, int cy, int cz) const { return chunkMap.find(ChunkMap::key(cx, cy, cz)); }
+    Chunk *addChunk(std::unique_ptr<Chunk> chunk);
+    void markDirty(int cx, int cy, int cz);
+    void installMesh(size_t index, std::unique_ptr<Mesh> mesh);
+    // Mesh a padded chunk volume (see Asteroid.cpp); safe on any thread
+    std::unique_ptr<Mesh> buildMesh(const uint8_t *volume) const;
 };
 class AsteroidRender
 {
 public:
-    // Renders the asteroid using per-chunk meshes, GLTextureAtlas, and lighting
-    static void render(const Asteroid &asteroid, const DotBlue::GLTextureAtlas &atlas, const glm::dmat4 &viewProj, const glm::vec3 &lightDir);
+    // Chunk counts for the last render() call
+    struct Stats
+    {
+        size_t chunks = 0;
+        size_t inFrustum = 0; // Chunks whose bounds passed the frustum test
+        size_t drawn = 0;     // Of those, chunks with geometry drawn unconditionally
+        size_t occluded = 0;  // Chunks hidden last frame, drawn only if their bounds pass
+        size_t drawCalls = 0; // Chunk geometry draw calls (one multi-draw covers all visible chunks)
+    };
+    static const Stats &getStats();
+    // Hardware occlusion queries on chunk bounds, read back a frame late (on by default)
+    static void setOcclusionCulling(bool enabled);
+    static bool getOcclusionCulling();
+
+    // Renders the asteroid using per-chunk meshes, GLTextureAtlas, and lighting. Uploads
+    // any meshes finished by the job system since the last frame first.
+    static void render(Asteroid &asteroid, const DotBlue::GLTextureAtlas &atlas, const glm::dmat4 &viewProj, const glm::vec3 &lightDir);
 };
 
 // FileSystem utility for config directory
@@ -62,11 +62,18 @@ static void HandleX11Event(void *xevent);
 #include <chrono>
 #include <thread>
 
+// Space digs a DIG_RADIUS sphere DIG_DISTANCE voxels ahead of the camera
+constexpr int DIG_RADIUS = 2;
+constexpr double DIG_DISTANCE = 4.0;
+// Edited chunks handed to the mesh workers per frame, bounding remesh and upload cost
+constexpr size_t REMESH_CHUNKS_PER_FRAME = 8;
+
 class Kosmos : public KosmosBase
 {
 private:
     Asteroid *asteroid = nullptr;
     AsteroidRender *asteroidRenderer = nullptr;
+    double meshBenchmarkMs = 0.0; // Last result of the UI's meshing benchmark
     DotBlue::GLTextureAtlas *atlas = nullptr;
     DotBlue::GLCamera camera;
     bool showKosmosUI;
@@ -115,8 +122,9 @@ public:
         ImGui_ImplOpenGL3_Init("#version 130");
         showKosmosUI = true;
 
-        // Load texture atlas (mc.png, 16x16 tiles)
-        atlas = new DotBlue::GLTextureAtlas("../assets/mc.png", 16, 16);
+        // Load texture atlas (mc.png, 16x16 tiles) as a mipmapped array texture so
+        // distant chunks don't shimmer
+        atlas = new DotBlue::GLTextureAtlas("../assets/mc.png", 16, 16, true);
         g_atlas_for_mesh = atlas;
         atlas->select(0); // Select the first tile for all faces
 
@@ -191,8 +199,7 @@ public:
             int wx = int(std::round(pos.x));
             int wy = int(std::round(pos.y));
             int wz = int(std::round(pos.z));
-            Voxel *v = asteroid->getVoxel(wx, wy, wz);
-            bool canMove = (!v || v->type == VoxelType::Empty);
+            bool canMove = asteroid->getVoxel(wx, wy, wz).type == VoxelType::Empty;
             // ...removed debug logging...
             return canMove;
         };
@@ -258,8 +265,11 @@ public:
         glm::dvec3 right = glm::normalize(glm::cross(forward, worldUp));
 
         bool moved = false;
+        bool dig = false;
         glm::dvec3 camPos = camera.getPosition();
 #ifdef _WIN32
+        if (GetAsyncKeyState(VK_SPACE) & 0x8000)
+            dig = true;
         if (GetAsyncKeyState('W') & 0x8000)
         {
             // ...removed debug logging...
@@ -335,6 +345,8 @@ public:
                 KeyCode kc = XKeysymToKeycode(display, ks);
                 return (keys[kc >> 3] & (1 << (kc & 7))) != 0;
             };
+            if (isKeyDown(XK_space))
+                dig = true;
             if (isKeyDown(XK_w))
             {
                 glm::dvec3 newPos = camPos + forward * speed;
@@ -391,6 +403,22 @@ public:
             }
         }
 #endif
+        if (dig)
+        {
+            // Carve a small sphere just in front of the camera; setVoxel marks the chunks
+            const glm::dvec3 hit = camPos + forward * DIG_DISTANCE;
+            const int hx = int(std::round(hit.x)), hy = int(std::round(hit.y)), hz = int(std::round(hit.z));
+            for (int z = -DIG_RADIUS; z <= DIG_RADIUS; ++z)
+                for (int y = -DIG_RADIUS; y <= DIG_RADIUS; ++y)
+                    for (int x = -DIG_RADIUS; x <= DIG_RADIUS; ++x)
+                        if (x * x + y * y + z * z <= DIG_RADIUS * DIG_RADIUS)
+                        {
+                            if (asteroid->getVoxel(hx + x, hy + y, hz + z).type != VoxelType::Empty)
+                                asteroid->setVoxel(hx + x, hy + y, hz + z, VoxelType::Empty);
+                        }
+        }
+        // Remesh a bounded number of edited chunks per frame; render() uploads the results
+        asteroid->remeshDirtyChunks(REMESH_CHUNKS_PER_FRAME);
         if (moved)
         {
             camera.setPosition(camPos);
@@ -434,6 +462,32 @@ public:
         {
             ImGui::Begin("Kosmos UI", &showKosmosUI);
             ImGui::Text("Asteroid at (0,0,0), camera at (0,0,-32)");
+            ImGui::Text("Chunk meshes: %zu vertices, %zu indices (%zu exposed faces)", asteroid->meshStats.vertices,
+                        asteroid->meshStats.indices, asteroid->meshStats.faces);
+            const AsteroidRender::Stats &renderStats = AsteroidRender::getStats();
+            ImGui::Text("Chunks: %zu, %zu in frustum, %zu drawn, %zu occluded (%zu draw calls)", renderStats.chunks,
+                        renderStats.inFrustum, renderStats.drawn, renderStats.occluded, renderStats.drawCalls);
+            bool occlusionCulling = AsteroidRender::getOcclusionCulling();
+            if (ImGui::Checkbox("Occlusion culling", &occlusionCulling))
+                AsteroidRender::setOcclusionCulling(occlusionCulling);
+            ImGui::Text("Allocated chunks: %zu (generated field %dx%dx%d, empty chunks elided)",
+                        asteroid->chunks.size(), asteroid->dimX, asteroid->dimY, asteroid->dimZ);
+            const Asteroid::StorageStats storage = asteroid->storageStats();
+            ImGui::Text("Voxel storage: %.1f KB (dense %.1f KB); %zu uniform, %zu palette, %zu dense chunks",
+                        storage.bytes / 1024.0, storage.denseBytes / 1024.0, storage.uniformChunks,
+                        storage.paletteChunks, storage.denseChunks);
+            ImGui::Text("Dirty chunks: %zu (space digs)", asteroid->dirtyChunkCount());
+            if (ImGui::Button("Benchmark meshing"))
+                meshBenchmarkMs = asteroid->benchmarkMeshing(10);
+            if (meshBenchmarkMs > 0.0)
+            {
+                ImGui::SameLine();
+                ImGui::Text("%.2f ms for %zu chunks (single thread)", meshBenchmarkMs, asteroid->chunks.size());
+            }
+            DotBlue::TextureMemoryStats texStats = DotBlue::GetTextureMemoryStats();
+            ImGui::Text("Textures: %u (%u evicted), %.1f MB resident, peak %.1f MB", texStats.textures,
+                        texStats.evicted, texStats.residentBytes / (1024.0 * 1024.0),
+                        texStats.peakBytes / (1024.0 * 1024.0));
             ImGui::End();
         }
 
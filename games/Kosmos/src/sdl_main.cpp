@@ -92,8 +92,7 @@ public:
             int wx = int(std::round(pos.x));
             int wy = int(std::round(pos.y));
             int wz = int(std::round(pos.z));
-            Voxel *v = asteroid->getVoxel(wx, wy, wz);
-            return (!v || v->type == VoxelType::Empty);
+            return asteroid->getVoxel(wx, wy, wz).type == VoxelType::Empty;
         };
         if (state[SDL_SCANCODE_W]) {
             glm::dvec3 newPos = camPos + forward * speed;
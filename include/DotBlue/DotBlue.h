@@ -18,6 +18,15 @@
 
 #include "GLPlatform.h"
 #include "Input.h"
+#include "GLStreamBuffer.h"
+#include "GLBatch2D.h"
+#include "GLSpriteBatch.h"
+#include "GLGlyphCache.h"
+#include "GLTextLayout.h"
+#include "GLTextureLoader.h"
+#include "GLTextureCache.h"
+#include "GLTextureRegistry.h"
+#include "JobSystem.h"
 #include <functional>
 
 namespace DotBlue
@@ -0,0 +1,145 @@
+#pragma once
+#include "GLPlatform.h"
+#include "GLStreamBuffer.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace DotBlue
+{
+    // Batched 2D primitive renderer.
+    //
+    // Lines, triangles, rectangles and textured quads/triangles are appended to one CPU
+    // vertex stream per vertex format and submitted as a handful of draw calls. Consecutive
+    // primitives sharing the same shader program, topology and texture are merged into a
+    // single draw. At flush time each stream is written once into the engine-wide
+    // GLStreamBuffer and drawn straight from there. Pending geometry is flushed
+    // automatically when a different GLShader is bound, when a uniform of the batched
+    // shader is set, and at the end of every frame.
+    // Code that changes GL state behind the engine's back (raw glUseProgram, ImGui, ...)
+    // should call FlushBatch2D() first.
+    //
+    // Vertex layouts match the old per-call helpers, so existing shaders keep working:
+    //   colored:  location 0 = vec3 position, location 1 = vec3 color
+    //   textured: location 0 = vec3 position, location 2 = vec2 texcoord
+    //
+    // Text is the exception: glyph quads are drawn with the batch's own text shader in
+    // pixel coordinates (top-left origin of the current viewport), so strings can be
+    // queued whatever program is bound and consecutive strings sharing a font texture
+    // collapse into one draw.
+    class Batch2D
+    {
+    public:
+        struct Stats
+        {
+            size_t vertices = 0;  // Vertices submitted since the last resetStats()
+            size_t drawCalls = 0; // Draw calls issued since the last resetStats()
+            size_t flushes = 0;   // Non-empty flushes since the last resetStats()
+        };
+
+        DOTBLUE_API Batch2D();
+        DOTBLUE_API ~Batch2D();
+
+        Batch2D(const Batch2D &) = delete;
+        Batch2D &operator=(const Batch2D &) = delete;
+
+        // Colored primitives (screen-space x/y, z = 0)
+        DOTBLUE_API void line(float x0, float y0, float x1, float y1, float r, float g, float b);
+        DOTBLUE_API void triangle(float x0, float y0, float x1, float y1, float x2, float y2, float r, float g, float b);
+        DOTBLUE_API void rectangle(float x0, float y0, float x1, float y1, float r, float g, float b);
+
+        // Textured primitives
+        DOTBLUE_API void texturedQuad(unsigned int textureID, float x0, float y0, float x1, float y1,
+                                      float u0, float v0, float u1, float v1);
+        DOTBLUE_API void texturedTriangle(unsigned int textureID,
+                                          float x0, float y0, float u0, float v0,
+                                          float x1, float y1, float u1, float v1,
+                                          float x2, float y2, float u2, float v2);
+
+        // Glyph quads from GLGlyphCache::buildQuads() (single-channel font texture, pixel coordinates)
+        DOTBLUE_API void text(unsigned int fontTexture, const stbtt_aligned_quad *quads, size_t count,
+                              const RGBA &color);
+        // Glyph quads sampling a signed distance field (edge at 0.5). outlineWidth and softness
+        // are in distance units: the outline grows the glyph outwards, softness widens the
+        // edge falloff (drop shadows)
+        DOTBLUE_API void sdfText(unsigned int fontTexture, const stbtt_aligned_quad *quads, size_t count,
+                                 const RGBA &color, const RGBA &outlineColor = RGBA(0.0f, 0.0f, 0.0f, 1.0f),
+                                 float outlineWidth = 0.0f, float softness = 0.0f);
+
+        // Submit everything queued so far with the program that was bound when it was queued
+        DOTBLUE_API void flush();
+
+        DOTBLUE_API bool hasPending() const { return !runs.empty(); }
+        DOTBLUE_API unsigned int getProgram() const { return program; }
+        // True once a primitive drawn with the caller's program is queued (text does not count)
+        DOTBLUE_API bool usesProgram() const { return programCaptured; }
+        DOTBLUE_API const Stats &getStats() const { return stats; }
+        DOTBLUE_API void resetStats() { stats = Stats(); }
+
+    private:
+        enum Format
+        {
+            FORMAT_COLOR,
+            FORMAT_TEXTURED,
+            FORMAT_TEXT,    // Coverage font textures, textPipelines[0]
+            FORMAT_SDF_TEXT // Distance field font textures, textPipelines[1]
+        };
+
+        // Shared by both text formats; the coverage shader ignores the outline fields
+        struct TextVertex
+        {
+            float x, y, u, v;
+            uint8_t r, g, b, a;
+            uint8_t outlineR, outlineG, outlineB, outlineA;
+            float outlineWidth, softness;
+        };
+
+        // Text shader and the VAO matching its attribute locations
+        struct TextPipeline
+        {
+            GLShader shader;
+            GLShader::Uniform projection;
+            unsigned int vao = 0;
+            bool loaded = false;
+            bool failed = false;
+        };
+
+        // A contiguous range of one vertex stream drawn with a single call
+        struct Run
+        {
+            unsigned int mode;
+            Format format;
+            unsigned int textureID;
+            size_t first;
+            size_t count;
+        };
+
+        std::vector<float> colorVertices;    // x, y, z, r, g, b
+        std::vector<float> texturedVertices; // x, y, z, u, v
+        std::vector<TextVertex> textVertices;
+        std::vector<Run> runs;
+        unsigned int program;
+        bool programCaptured;
+        bool flushing;
+        unsigned int colorVAO, texturedVAO;
+        unsigned int streamGeneration; // GLStreamBuffer generation the VAOs point into
+        TextPipeline textPipelines[2];
+        Stats stats;
+
+        void initBuffers(const GLStreamBuffer &stream);
+        bool initTextPipeline(Format format);
+        void pushText(Format format, unsigned int fontTexture, const stbtt_aligned_quad *quads, size_t count,
+                      const RGBA &color, const RGBA &outlineColor, float outlineWidth, float softness);
+        void begin(size_t newVertices, bool usesCallerProgram);
+        void addRun(unsigned int mode, Format format, unsigned int textureID, size_t first, size_t count);
+    };
+
+    // Engine-wide batch used by GLLineShader, GLRectangleShader, TexturedQuadShader, ...
+    DOTBLUE_API Batch2D &GetBatch2D();
+    DOTBLUE_API void FlushBatch2D();
+
+    // Internal hooks (called by GLShader and the frame loop)
+    void Batch2DOnBindProgram(unsigned int program);
+    void Batch2DOnSetUniform(unsigned int program);
+    void ShutdownBatch2D();
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "GLPlatform.h"
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace DotBlue
+{
+    // Lazily rasterized glyph atlas for one TrueType font at one pixel height.
+    //
+    // Glyphs are rasterized with stb_truetype the first time a codepoint is requested and
+    // packed (skyline, via imstb_rectpack) into single-channel atlas pages. A full page
+    // doubles in size up to kMaxPageSize, keeping its existing glyphs in place; after that
+    // a new page is started. Each page keeps a CPU copy and a dirty rectangle, and
+    // upload() sends only the dirty sub-rectangle to the GPU.
+    //
+    // Texture memory is bounded by the budget: when no page can take a new glyph without
+    // exceeding it, the least recently used page is cleared and reused. The packer cannot
+    // free single rectangles, so eviction is per page. Pages touched by the string being
+    // laid out are never evicted; if every page is in use the budget is exceeded instead.
+    //
+    // In SDF mode glyphs are stored as signed distance fields (stbtt_GetGlyphSDF) at the
+    // font's pixel height, which then acts as a reference size: the same pages draw text
+    // at any size through Batch2D::sdfText(), with optional outlines and soft shadows.
+    class GLGlyphCache
+    {
+    public:
+        static const int kInitialPageSize = 256;
+        static const int kMaxPageSize = 2048;
+        static const size_t kDefaultBudget = 8u << 20;
+
+        // Distance field parameters: kSDFPadding texels of falloff around each glyph, the edge
+        // stored as 128 and each texel of distance worth kSDFDistanceScale steps
+        static const int kSDFPadding = 6;
+        static const int kSDFOnEdge = 128;
+        static constexpr float kSDFDistanceScale = 128.0f / kSDFPadding;
+
+        enum class Mode
+        {
+            Bitmap, // Coverage at exactly pixelHeight
+            SDF     // Distance field usable at any size
+        };
+
+        struct Glyph
+        {
+            int page = -1;              // Atlas page, -1 for glyphs without pixels (spaces)
+            int x = 0, y = 0;           // Bitmap position inside the page, in pixels
+            int width = 0, height = 0;  // Bitmap size in pixels
+            float xoff = 0.0f;          // Bitmap offset from the pen position (y down)
+            float yoff = 0.0f;
+            float advance = 0.0f;       // Horizontal pen advance in pixels
+        };
+
+        struct Stats
+        {
+            size_t glyphs = 0;       // Glyphs currently cached
+            size_t pages = 0;        // Atlas pages allocated
+            size_t textureBytes = 0; // GPU bytes used by all pages
+            size_t rasterized = 0;   // Glyphs rasterized since creation
+            size_t evictions = 0;    // Pages cleared to make room
+            size_t uploadBytes = 0;  // Bytes sent with glTexImage2D/glTexSubImage2D
+        };
+
+        DOTBLUE_API GLGlyphCache(std::vector<unsigned char> &&ttfData, float pixelHeight,
+                                 Mode mode = Mode::Bitmap, size_t budgetBytes = kDefaultBudget);
+        DOTBLUE_API ~GLGlyphCache();
+
+        GLGlyphCache(const GLGlyphCache &) = delete;
+        GLGlyphCache &operator=(const GLGlyphCache &) = delete;
+
+        DOTBLUE_API bool isValid() const { return valid; }
+
+        // Look up a glyph, rasterizing it on first use (nullptr if the font failed to load)
+        DOTBLUE_API const Glyph *getGlyph(uint32_t codepoint);
+
+        // Lay out a UTF-8 string with its baseline at y, advancing x. Appends one quad per
+        // visible glyph and, in textures, the atlas page texture it samples. Missing glyphs
+        // are rasterized and uploaded before this returns, so the quads can be drawn directly.
+        // size is the text height in pixels (0 = pixelHeight); bitmap fonts are only sharp at
+        // their own size.
+        DOTBLUE_API void buildQuads(const char *utf8, float &x, float y,
+                                    std::vector<stbtt_aligned_quad> &quads, std::vector<unsigned int> &textures,
+                                    float size = 0.0f);
+
+        // Quad for a resolved glyph with its pen at (penX, baseline), drawn at size
+        DOTBLUE_API stbtt_aligned_quad makeQuad(const Glyph &glyph, float penX, float baseline, float size = 0.0f) const;
+
+        // Start a new use: pages touched from here on (by getGlyph() or touchPage()) are
+        // pinned against eviction until the next call. buildQuads() does this per string.
+        DOTBLUE_API void beginUse() { ++useClock; }
+        DOTBLUE_API void touchPage(int page);
+
+        // Bumped whenever glyphs move or disappear (page growth, eviction); quads built
+        // at an older generation must be rebuilt
+        DOTBLUE_API uint64_t getGeneration() const { return generation; }
+
+        // Convert a width in screen pixels, for text drawn at size, into distance-field units
+        // for Batch2D::sdfText() (clamped to what the field padding can represent)
+        DOTBLUE_API float sdfDistance(float pixels, float size) const;
+
+        // Send dirty page regions to the GPU
+        DOTBLUE_API void upload();
+
+        DOTBLUE_API Mode getMode() const { return mode; }
+        DOTBLUE_API bool isSDF() const { return mode == Mode::SDF; }
+        DOTBLUE_API float getPixelHeight() const { return pixelHeight; }
+        DOTBLUE_API float getAscent() const { return ascent; }   // Pixels above the baseline
+        DOTBLUE_API float getDescent() const { return descent; } // Pixels below the baseline (negative)
+        DOTBLUE_API float getLineGap() const { return lineGap; }
+        DOTBLUE_API unsigned int getPageTexture(int page) const;
+        DOTBLUE_API void setBudget(size_t bytes) { budget = bytes; }
+        DOTBLUE_API size_t getBudget() const { return budget; }
+        DOTBLUE_API const Stats &getStats() const { return stats; }
+
+    private:
+        struct Page;
+        struct PlacedGlyph
+        {
+            const Glyph *glyph;
+            float x;
+        };
+
+        std::vector<unsigned char> ttf;
+        stbtt_fontinfo info;
+        bool valid;
+        Mode mode;
+        float pixelHeight, scale;
+        float ascent, descent, lineGap;
+        size_t budget;
+        uint64_t useClock; // Bumped per laid-out string; pages used at the current value are pinned
+        uint64_t generation;
+        bool budgetWarned;
+        std::unordered_map<uint32_t, Glyph> glyphs;
+        std::vector<std::unique_ptr<Page>> pages;
+        std::vector<PlacedGlyph> placed;
+        Stats stats;
+
+        size_t textureBytes() const;
+        bool allocate(int width, int height, int &page, int &x, int &y);
+        void growPage(Page &page);
+        void evictPage(int index);
+        void newPage();
+        void updateStats();
+    };
+
+    // Decode one UTF-8 sequence and advance text past it (U+FFFD for malformed input)
+    DOTBLUE_API uint32_t DecodeUTF8(const char *&text);
+}
@@ -1,6 +1,12 @@
 #pragma once
 #include <atomic>
 #include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
 #include "stb_truetype.h"
 #include "stb_image.h"
 
@@ -45,6 +51,32 @@ namespace DotBlue
         double longitude;  // Degrees, -180 to +180
         double radius;     // Meters (or your unit)
     };
+    // Box bounds in structure-of-arrays form for GLFrustum::cullBoxes: centres and half
+    // extents as floats relative to a double-precision origin, so large worlds keep precision
+    struct GLBoundsBatch {
+        glm::dvec3 origin = glm::dvec3(0.0);
+        std::vector<float> centerX, centerY, centerZ;
+        std::vector<float> extentX, extentY, extentZ;
+
+        DOTBLUE_API void clear();
+        DOTBLUE_API void addBox(const glm::dvec3& boxMin, const glm::dvec3& boxMax);
+        size_t size() const { return centerX.size(); }
+    };
+
+    // View frustum as six normalised planes (xyz = inward normal, w = offset): left,
+    // right, bottom, top, near, far. Extracted from a view-projection matrix using
+    // OpenGL's -w..w clip volume, which also contains GLM's zero-to-one depth range.
+    struct GLFrustum {
+        glm::dvec4 planes[6];
+
+        DOTBLUE_API static GLFrustum fromMatrix(const glm::dmat4& viewProj);
+        // Conservative: may accept boxes just outside a frustum corner, never rejects visible ones
+        DOTBLUE_API bool intersectsSphere(const glm::dvec3& center, double radius) const;
+        DOTBLUE_API bool intersectsAABB(const glm::dvec3& boxMin, const glm::dvec3& boxMax) const;
+        // Test every box in the batch: visible[i] becomes 1 or 0. Returns the visible count.
+        DOTBLUE_API size_t cullBoxes(const GLBoundsBatch& boxes, std::vector<uint8_t>& visible) const;
+    };
+
     // Double-precision camera for planetary rendering
     class GLCamera {
     public:
@@ -66,6 +98,8 @@ namespace DotBlue
 
         DOTBLUE_API glm::dmat4 getViewMatrix() const;
         DOTBLUE_API glm::dmat4 getProjectionMatrix() const;
+        // Frustum of getProjectionMatrix() * getViewMatrix()
+        DOTBLUE_API GLFrustum getFrustum() const;
 
         DOTBLUE_API void move(const glm::dvec3& delta);
         DOTBLUE_API void rotate(double yaw, double pitch);
@@ -87,11 +121,17 @@ namespace DotBlue
     using Mat4 = glm::mat4;
     using Quat = glm::quat;
     
+    class GLGlyphCache;
+    class TextLayout;
+    // Replaces the old baked-ASCII font (textureID, width, height, cdata[96]), whose glyphs
+    // lived in one fixed texture; text now spans several atlas pages.
     struct GLFont
     {
-        unsigned int textureID;
-        int width, height;
-        stbtt_bakedchar cdata[96]; // ASCII 32..126
+        std::shared_ptr<GLGlyphCache> glyphs; // Rasterizes UTF-8 glyphs on demand; null if loading failed
+
+        // First atlas page (0 if none yet), for code written against the old textureID field.
+        // Other glyphs may be on later pages; draw with GLPrintf instead.
+        [[deprecated("glyphs span several pages; draw with GLPrintf")]] DOTBLUE_API unsigned int getTextureID() const;
     };
     struct RGBA
     {
@@ -105,19 +145,69 @@ namespace DotBlue
         Vec3 toVec3() const { return Vec3(r, g, b); }
     };
 
+    // Options for GLPrintfStyled; sizes and widths are in screen pixels
+    struct TextStyle
+    {
+        float size = 0.0f;                             // Text height, 0 = the font's own pixel height
+        RGBA outlineColor = RGBA(0.0f, 0.0f, 0.0f, 1.0f);
+        float outlineWidth = 0.0f;                     // SDF fonts only
+        RGBA shadowColor = RGBA(0.0f, 0.0f, 0.0f, 0.6f);
+        float shadowOffsetX = 0.0f;                    // No shadow while both offsets are 0
+        float shadowOffsetY = 0.0f;
+        float shadowSoftness = 0.0f;                   // Shadow blur, SDF fonts only
+    };
+
     class GLShader
     {
     public:
+        // Cached uniform handle. Look it up once with getUniform() and reuse it every
+        // frame; it stays valid until the shader is reloaded.
+        struct Uniform
+        {
+            int location = -1;
+            int slot = -1; // Index into the shader's reflected uniform table
+            bool isValid() const { return location >= 0; }
+        };
+
+        enum class State
+        {
+            Empty,   // Nothing loaded
+            Pending, // loadAsync() issued, driver still compiling/linking
+            Ready,   // Linked and usable
+            Failed   // Compile or link error (logged)
+        };
+
         DOTBLUE_API GLShader();
         DOTBLUE_API ~GLShader();
 
+        // Owns a GL program, and a pending shader is tracked by address until it finishes
+        GLShader(const GLShader &) = delete;
+        GLShader &operator=(const GLShader &) = delete;
+
         DOTBLUE_API bool load(const std::string &vertexSrc, const std::string &fragmentSrc);
+        // Issue compile + link without waiting for the result. The engine polls pending
+        // programs every frame (GL_COMPLETION_STATUS_KHR when KHR_parallel_shader_compile
+        // is available, otherwise it checks on the following frame); bind() and
+        // getUniform() finish a still-pending program synchronously.
+        DOTBLUE_API bool loadAsync(const std::string &vertexSrc, const std::string &fragmentSrc);
+        DOTBLUE_API bool poll(); // Non-blocking; returns true once Ready
+        DOTBLUE_API bool wait(); // Blocks until the program is Ready or Failed
+        DOTBLUE_API State getState() const { return state; }
+        DOTBLUE_API bool isReady() const { return state == State::Ready; }
         DOTBLUE_API bool loadFromFiles(const std::string &vertexPath, const std::string &fragmentPath);
         DOTBLUE_API void bind() const;
         DOTBLUE_API void unbind() const;
         DOTBLUE_API unsigned int getProgram() const { return programID; }
-        
-        // Uniform setters
+
+        // Uniform lookup (hashed table filled from the active uniforms at link time)
+        DOTBLUE_API Uniform getUniform(const std::string &name) const;
+        DOTBLUE_API int getUniformLocation(const std::string &name) const { return getUniform(name).location; }
+        // Forget the last values sent, e.g. after setting uniforms with raw glUniform* calls
+        DOTBLUE_API void invalidateUniformCache() const;
+
+        // Uniform setters. Values equal to the last one sent through this shader are not
+        // re-sent. They go straight to this program where glProgramUniform* is available;
+        // otherwise, like glUniform*, they apply to the currently bound program, so bind first.
         DOTBLUE_API void setFloat(const std::string &name, float value) const;
         DOTBLUE_API void setVec2(const std::string &name, float x, float y) const;
         DOTBLUE_API void setVec3(const std::string &name, float x, float y, float z) const;
@@ -130,36 +220,155 @@ namespace DotBlue
         DOTBLUE_API void setMat3(const std::string &name, const Mat3 &matrix) const;
         DOTBLUE_API void setMat4(const std::string &name, const Mat4 &matrix) const;
 
+        // Handle-based uniform setters (no name lookup)
+        DOTBLUE_API void setFloat(const Uniform &uniform, float value) const;
+        DOTBLUE_API void setInt(const Uniform &uniform, int value) const;
+        DOTBLUE_API void setVec2(const Uniform &uniform, const Vec2 &value) const;
+        DOTBLUE_API void setVec3(const Uniform &uniform, const Vec3 &value) const;
+        DOTBLUE_API void setVec4(const Uniform &uniform, const Vec4 &value) const;
+        DOTBLUE_API void setMat3(const Uniform &uniform, const Mat3 &matrix) const;
+        DOTBLUE_API void setMat4(const Uniform &uniform, const Mat4 &matrix) const;
+
     private:
-        unsigned int programID;
+        // One entry per active uniform (plus any array element looked up by name)
+        struct UniformSlot
+        {
+            int location;
+            bool hasValue;
+            unsigned char value[16 * sizeof(float)]; // Last value sent, large enough for a mat4
+        };
+
+        // Mutable so const users (bind(), getUniform()) can finish a pending program
+        mutable unsigned int programID;
+        mutable State state;
+        mutable unsigned int pendingVS, pendingFS;
+        std::string pendingCachePath;
+        uint64_t pendingFrame;
+        mutable std::unordered_map<std::string, int> uniformSlots; // name -> slot, -1 if not active
+        mutable std::vector<UniformSlot> slots;
+
         unsigned int compileShader(unsigned int type, const std::string &src);
         void deleteProgram();
+        bool finishPending() const;
+        void reflectUniforms() const;
+        int addSlot(int location) const;
+        bool uniformChanged(const Uniform &uniform, const void *value, size_t bytes) const;
+    };
+
+    // Program binary cache counters (see SetShaderCacheDirectory)
+    struct ShaderCacheStats
+    {
+        unsigned int hits = 0;   // Programs restored with glProgramBinary
+        unsigned int misses = 0; // Programs compiled from source (and then stored)
+        unsigned int stale = 0;  // Cache entries the driver rejected
+        unsigned int stores = 0; // Binaries written to the cache directory
     };
 
+    // GLShader::load() caches linked program binaries in this directory and reloads them
+    // on the next start. Defaults to <temp>/dotblue_shadercache; an empty path disables it.
+    DOTBLUE_API void SetShaderCacheDirectory(const std::string &dir);
+    DOTBLUE_API const std::string &GetShaderCacheDirectory();
+    DOTBLUE_API ShaderCacheStats GetShaderCacheStats();
+
+    // Number of GLShader::loadAsync() programs not finalized yet
+    DOTBLUE_API size_t GetPendingShaderCount();
+    void PollPendingShaders(); // Internal, called once per frame
+
+    class SpriteBatch;
+
     class GLTextureAtlas
     {
     public:
-        DOTBLUE_API GLTextureAtlas(const std::string &pngPath, int imgWidth, int imgHeight);
+        // Where one named image sits in a packed atlas
+        struct Region
+        {
+            std::string name;
+            int x, y, width, height;  // Pixels, excluding padding and extrusion
+            float u0, v0, u1, v1;
+        };
+
+        // Packs many separate images into one atlas texture with imstb_rectpack.
+        //
+        // Each image is surrounded by `extrude` copies of its edge pixels (so linear
+        // filtering at the border samples the image itself) and then `padding` empty
+        // texels. PNGs are decoded and blitted on worker threads and every candidate
+        // atlas size is packed in parallel; the smallest that fits wins. The result only
+        // depends on the images and their names, never on thread timing or add() order,
+        // so an atlas built from the same inputs comes out identical every time.
+        class Builder
+        {
+        public:
+            DOTBLUE_API Builder &setPadding(int pixels);   // Default 1
+            DOTBLUE_API Builder &setExtrude(int pixels);   // Default 1
+            DOTBLUE_API Builder &setMaxSize(int pixels);   // Largest atlas edge, default 4096
+            DOTBLUE_API Builder &add(const std::string &name, const std::string &pngPath);
+            DOTBLUE_API Builder &add(const std::string &name, const unsigned char *rgba, int width, int height);
+
+            // Null if nothing could be decoded or the images do not fit in maxSize
+            DOTBLUE_API std::unique_ptr<GLTextureAtlas> build() const;
+
+        private:
+            struct Entry
+            {
+                std::string name;
+                std::string path;
+                std::vector<unsigned char> pixels; // RGBA, empty until decoded for files
+                int width = 0, height = 0;
+            };
+
+            int padding = 1;
+            int extrude = 1;
+            int maxSize = 4096;
+            std::vector<Entry> entries;
+        };
+
+        // Grid atlas of imgWidth x imgHeight tiles. With arrayTexture the grid is also
+        // sliced into a GL_TEXTURE_2D_ARRAY, one layer per tile with its own full mip
+        // chain, so distant surfaces can be mipmapped without neighbouring tiles bleeding
+        // in. Sample it with getSelectedLayer() and 0..1 tile UVs (which may also repeat).
+        DOTBLUE_API GLTextureAtlas(const std::string &pngPath, int imgWidth, int imgHeight, bool arrayTexture = false);
         DOTBLUE_API ~GLTextureAtlas();
 
-        DOTBLUE_API void select(int index);                                   // Select image by index (0-based, left-to-right, top-to-bottom)
-        DOTBLUE_API void bind() const;                                        // Bind the atlas texture
+        DOTBLUE_API void select(int index);                                   // Select image by index (0-based, left-to-right, top-to-bottom; packed atlases: by name order)
+        DOTBLUE_API bool select(const std::string &name);                     // Packed atlases: select image by name
+        DOTBLUE_API void bind() const;                                        // Bind the atlas texture (the array texture in array mode)
         DOTBLUE_API void draw_quad(float x, float y, float w, float h) const; // Draw selected image at (x, y) with size (w, h)
+        DOTBLUE_API void draw_sprite(SpriteBatch &batch, float x, float y, float w, float h,
+                                     const RGBA &tint = RGBA(), float rotation = 0.0f, float depth = 0.0f) const; // Queue selected image into a sprite batch
 
         DOTBLUE_API int getImageCount() const { return rows * cols; }
+        DOTBLUE_API int getColumns() const { return cols; }
+        DOTBLUE_API int getRows() const { return rows; }
         DOTBLUE_API unsigned int getTextureID() const { return textureID; }
+        // Array mode: the GL_TEXTURE_2D_ARRAY, 0 if the atlas has none
+        DOTBLUE_API unsigned int getArrayTextureID() const { return arrayTextureID; }
+        DOTBLUE_API bool isArrayTexture() const { return arrayTextureID != 0; }
+        DOTBLUE_API int getWidth() const { return atlasWidth; }
+        DOTBLUE_API int getHeight() const { return atlasHeight; }
+
+        // Packed atlases: region by name, null if there is none
+        DOTBLUE_API const Region *findRegion(const std::string &name) const;
+        DOTBLUE_API const std::vector<Region> &getRegions() const { return regions; }
         
         // Get UV coordinates for selected image
         DOTBLUE_API void getSelectedUVs(float& u0_out, float& v0_out, float& u1_out, float& v1_out) const {
             u0_out = u0; v0_out = v0; u1_out = u1; v1_out = v1;
         } 
+        // Array layer of the selected image (array mode; equals the grid index)
+        DOTBLUE_API int getSelectedLayer() const { return selectedIndex; }
     private:
+        GLTextureAtlas();
+        void createArrayTexture();
+
         unsigned int textureID;
+        unsigned int arrayTextureID;
         int atlasWidth, atlasHeight;
         int imgWidth, imgHeight;
         int rows, cols;
         int selectedIndex;
         float u0, v0, u1, v1; // UVs for selected image
+        std::vector<Region> regions; // Packed atlases only, sorted by name
+        std::unordered_map<std::string, size_t> regionIndex;
     };
 
     void InitApp();
@@ -176,8 +385,21 @@ namespace DotBlue
     DOTBLUE_API void GLSleep(int ms);
     DOTBLUE_API GLFont LoadFont(const char *fontPath, float pixelHeight = 14.0f);
     DOTBLUE_API void GLPrintf(const GLFont &font, float x, float y, const RGBA &color, const char *fmt, ...);
+    // Signed-distance-field font: one glyph atlas at referenceHeight serves every text size
+    DOTBLUE_API GLFont LoadFontSDF(const char *fontPath, float referenceHeight = 32.0f);
+    DOTBLUE_API void GLPrintfStyled(const GLFont &font, float x, float y, const RGBA &color, const TextStyle &style,
+                                    const char *fmt, ...);
+    // Draw a layout from GetTextLayout() without decoding or measuring the string again
+    DOTBLUE_API void GLPrintf(const TextLayout &layout, float x, float y, const RGBA &color);
+    DOTBLUE_API void GLPrintfStyled(const TextLayout &layout, float x, float y, const RGBA &color, const TextStyle &style);
+    // ASCII only: bytes of a UTF-8 sequence (>= 0x80) measure 0; use GetGlyphWidth/Height
+    // with a decoded codepoint (DecodeUTF8) for anything else
     DOTBLUE_API float GetCharHeight(const GLFont &font, char c);
     DOTBLUE_API float GetCharWidth(const GLFont &font, char c);
+    DOTBLUE_API float GetGlyphHeight(const GLFont &font, uint32_t codepoint);
+    DOTBLUE_API float GetGlyphWidth(const GLFont &font, uint32_t codepoint);
+    // Single-line advance width and tallest glyph; use GetTextLayout() for multi-line text
+    DOTBLUE_API std::pair<float, float> GetStringDimensions(const GLFont &font, const std::string &str);
     DOTBLUE_API void SetApplicationTitle(const std::string &title);
     DOTBLUE_API unsigned int LoadPNGTexture(const std::string &filename);
     DOTBLUE_API void GLDisableTextureFiltering(unsigned int textureID);
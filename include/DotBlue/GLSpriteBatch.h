@@ -0,0 +1,78 @@
+#pragma once
+#include "GLPlatform.h"
+#include "GLStreamBuffer.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace DotBlue
+{
+    // Texture-sorted, instanced sprite renderer.
+    //
+    // Sprites queued between begin() and end() are stable-sorted by depth (back to front)
+    // and then by texture, so submission order is kept within each (depth, texture) pair.
+    // Each run of sprites sharing a texture is drawn with one instanced call: a 4-vertex
+    // strip expanded in the vertex shader from a 40-byte per-instance record streamed
+    // through the engine-wide GLStreamBuffer.
+    //
+    // Coordinates are in pixels with a top-left origin, like the u_resolution shaders used
+    // with GLRectangleShader. Rotation is in radians around the sprite centre. Blending is
+    // left to the caller. Requires OpenGL 3.3 (instanced arrays).
+    class SpriteBatch
+    {
+    public:
+        struct Stats
+        {
+            size_t sprites = 0;   // Sprites drawn by the last end()
+            size_t drawCalls = 0; // Instanced draws issued by the last end()
+        };
+
+        DOTBLUE_API SpriteBatch();
+        DOTBLUE_API ~SpriteBatch();
+
+        SpriteBatch(const SpriteBatch &) = delete;
+        SpriteBatch &operator=(const SpriteBatch &) = delete;
+
+        // Start a batch for a viewport of the given size (0 = current render window size)
+        DOTBLUE_API void begin(int viewportWidth = 0, int viewportHeight = 0);
+
+        DOTBLUE_API void draw(unsigned int textureID, float x, float y, float w, float h,
+                              float u0 = 0.0f, float v0 = 0.0f, float u1 = 1.0f, float v1 = 1.0f,
+                              const RGBA &tint = RGBA(), float rotation = 0.0f, float depth = 0.0f);
+
+        // Sort and submit everything queued since begin()
+        DOTBLUE_API void end();
+
+        DOTBLUE_API size_t getQueuedCount() const { return instances.size(); }
+        DOTBLUE_API const Stats &getStats() const { return stats; }
+
+    private:
+        // Per-instance attributes, uploaded as-is
+        struct Instance
+        {
+            float x, y, w, h;     // location 0
+            float u0, v0, u1, v1; // location 1
+            uint8_t r, g, b, a;   // location 2 (normalized)
+            float rotation;       // location 3
+        };
+
+        struct SortKey
+        {
+            uint64_t key; // depth in the high 32 bits, texture in the low 32 bits
+            uint32_t index;
+        };
+
+        std::vector<Instance> instances;
+        std::vector<SortKey> keys;
+        std::vector<Instance> sorted;
+        GLShader shader;
+        bool shaderLoaded;
+        unsigned int vao;
+        unsigned int streamGeneration;
+        int width, height;
+        Stats stats;
+
+        bool initResources();
+        void pointInstanceAttributes(size_t offset);
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "GLPlatform.h"
+#include <cstddef>
+
+namespace DotBlue
+{
+    // Streaming allocator for dynamic vertex data.
+    //
+    // With GL_ARB_buffer_storage (or GL 4.4) the buffer is created immutable, mapped once
+    // (persistent + coherent) and split into kRegionCount regions. Writes are appended to
+    // the current region; at the end of a frame (or when a region fills up) a fence is
+    // inserted and the next region is used, waiting on its fence only if the GPU is still
+    // reading it. Nothing already written is overwritten until two more regions have been
+    // retired, so ranges handed out stay valid for the draws that consume them.
+    //
+    // Without buffer storage the buffer falls back to orphaning: writes are appended with
+    // unsynchronized glMapBufferRange and the storage is re-specified when it fills up.
+    //
+    // write() leaves the stream buffer bound to GL_ARRAY_BUFFER.
+    class GLStreamBuffer
+    {
+    public:
+        static const int kRegionCount = 3;
+
+        DOTBLUE_API explicit GLStreamBuffer(size_t regionSize = 4 << 20);
+        DOTBLUE_API ~GLStreamBuffer();
+
+        GLStreamBuffer(const GLStreamBuffer &) = delete;
+        GLStreamBuffer &operator=(const GLStreamBuffer &) = delete;
+
+        // Make sure the next `bytes` (plus alignment padding) of writes land in the same
+        // storage, so a group of writes consumed by one draw is never split by orphaning.
+        DOTBLUE_API void reserve(size_t bytes);
+
+        // Copy data into the buffer and return its byte offset. The offset is a multiple
+        // of `alignment` from the start of the buffer, so passing the vertex stride lets
+        // callers draw with first = offset / stride from a VAO set up at offset 0.
+        DOTBLUE_API size_t write(const void *data, size_t bytes, size_t alignment = 16);
+
+        // Retire the current region (called once per frame by the engine)
+        DOTBLUE_API void endFrame();
+
+        DOTBLUE_API unsigned int getBuffer() const { return buffer; }
+        // Bumped whenever the GL buffer object is recreated; VAOs must be re-pointed
+        DOTBLUE_API unsigned int getGeneration() const { return generation; }
+        DOTBLUE_API bool isPersistent() const { return persistent; }
+        DOTBLUE_API size_t getCapacity() const { return regionSize * kRegionCount; }
+
+    private:
+        unsigned int buffer;
+        unsigned int generation;
+        size_t regionSize;
+        bool persistent;
+        unsigned char *mapped; // Persistent mapping of the whole buffer
+        int region;            // Current region (persistent mode)
+        size_t cursor;         // Next free byte, absolute offset into the buffer
+        void *fences[kRegionCount];
+
+        void create(size_t newRegionSize);
+        void destroy();
+        void advanceRegion();
+        void waitRegion(int index);
+        size_t regionEnd() const;
+    };
+
+    // Engine-wide stream buffer shared by Batch2D, GLPrintf and other immediate-style helpers
+    DOTBLUE_API GLStreamBuffer &GetStreamBuffer();
+
+    // Internal hooks (called by the frame loop)
+    void StreamBufferEndFrame();
+    void ShutdownStreamBuffer();
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "GLPlatform.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace DotBlue
+{
+    // Positioned glyphs for one UTF-8 string in one font.
+    //
+    // build() decodes, measures and line-breaks the string once: '\n' starts a new line
+    // and, with a maxWidth, lines wrap at the last space (or mid-word when a single word
+    // is too long). Positions are relative to the baseline of the first line, matching
+    // the x, y passed to GLPrintf. Drawing with GLPrintf(layout, ...) reuses the stored
+    // glyph quads and only rebuilds them when the font's atlas has moved glyphs since.
+    class TextLayout
+    {
+    public:
+        struct Line
+        {
+            size_t firstGlyph;
+            size_t glyphCount;
+            float width;    // Advance width without trailing spaces
+            float baseline; // Relative to the first line's baseline
+        };
+
+        DOTBLUE_API TextLayout();
+
+        DOTBLUE_API void build(const GLFont &font, const std::string &text, float maxWidth = 0.0f, float size = 0.0f);
+
+        DOTBLUE_API bool isValid() const { return !font.expired(); }
+        DOTBLUE_API float getWidth() const { return width; }             // Widest line
+        DOTBLUE_API float getHeight() const { return height; }           // Line count times line height
+        DOTBLUE_API float getTop() const { return top; }                 // Top of the first line (negative ascent)
+        DOTBLUE_API float getLineHeight() const { return lineHeight; }
+        DOTBLUE_API float getMaxGlyphHeight() const { return maxGlyphHeight; }
+        DOTBLUE_API float getSize() const { return size; }
+        DOTBLUE_API const std::vector<Line> &getLines() const { return lines; }
+        DOTBLUE_API size_t getGlyphCount() const { return glyphs.size(); }
+        DOTBLUE_API std::shared_ptr<GLGlyphCache> getFont() const { return font.lock(); }
+
+        // Append the glyph quads translated to (x, y) and the page texture of each.
+        // Returns false if the font has been destroyed.
+        DOTBLUE_API bool getQuads(float x, float y, std::vector<stbtt_aligned_quad> &outQuads,
+                                  std::vector<unsigned int> &outTextures) const;
+
+    private:
+        struct PlacedGlyph
+        {
+            uint32_t codepoint;
+            float x;
+            uint32_t line;
+        };
+
+        std::weak_ptr<GLGlyphCache> font;
+        float size;
+        float width, height, top, lineHeight, maxGlyphHeight;
+        std::vector<PlacedGlyph> glyphs;
+        std::vector<Line> lines;
+
+        // Quads at the origin, valid while the font's generation matches
+        mutable std::vector<stbtt_aligned_quad> quads;
+        mutable std::vector<unsigned int> textures;
+        mutable std::vector<int> pages; // Distinct atlas pages used, touched on every draw
+        mutable uint64_t quadGeneration;
+        mutable bool quadsValid;
+
+        void refreshQuads(GLGlyphCache &cache) const;
+    };
+
+    // Layout for (font, text, maxWidth, size), built on first request and reused after that.
+    // Shared so a layout the caller holds survives being trimmed from the cache.
+    DOTBLUE_API std::shared_ptr<const TextLayout> GetTextLayout(const GLFont &font, const std::string &text,
+                                                                float maxWidth = 0.0f, float size = 0.0f);
+    DOTBLUE_API void ClearTextLayoutCache();
+
+    // Internal (called on shutdown)
+    void ShutdownTextLayoutCache();
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "GLPlatform.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace DotBlue
+{
+    // GPU-ready texture containers (.dbtex).
+    //
+    // A container holds a header, the mip chain (RGBA8, or BC1/BC3 blocks encoded on the
+    // CPU) and, for packed atlases, the region table. LoadPNGTexture() and GLTextureAtlas
+    // convert their sources into the texture cache directory the first time they see them;
+    // later runs mmap the container and upload every level straight from the mapping
+    // instead of decoding the PNGs again. Entries are keyed by the source path, size and
+    // modification time plus the cache options, so editing an asset simply misses.
+
+    enum class TextureCompression
+    {
+        RGBA8, // Uncompressed
+        BC1,  // Opaque DXT1, 4 bits per texel
+        BC3,  // DXT5 with interpolated alpha, 8 bits per texel
+        Auto  // BC1 for fully opaque images, BC3 otherwise
+    };
+
+    struct TextureCacheOptions
+    {
+        TextureCompression compression = TextureCompression::RGBA8;
+        bool mipmaps = false; // Store a box-filtered mip chain and sample it trilinearly
+    };
+
+    // Texture cache counters (see SetTextureCacheDirectory)
+    struct TextureCacheStats
+    {
+        unsigned int hits = 0;     // Textures uploaded from a mapped container
+        unsigned int misses = 0;   // Textures decoded from their source image
+        unsigned int stores = 0;   // Containers written
+        unsigned int rejected = 0; // Containers that were corrupt or used an unsupported format
+    };
+
+    // Containers are written to and read from this directory. Defaults to
+    // <temp>/dotblue_texcache; an empty path disables the cache.
+    DOTBLUE_API void SetTextureCacheDirectory(const std::string &dir);
+    DOTBLUE_API const std::string &GetTextureCacheDirectory();
+    // Options for containers written from now on (existing entries keep their own)
+    DOTBLUE_API void SetTextureCacheOptions(const TextureCacheOptions &options);
+    DOTBLUE_API const TextureCacheOptions &GetTextureCacheOptions();
+    DOTBLUE_API TextureCacheStats GetTextureCacheStats();
+
+    // Offline conversion: write a container for an RGBA8 image
+    DOTBLUE_API bool WriteTextureContainer(const std::string &path, const unsigned char *rgba, int width, int height,
+                                           const TextureCacheOptions &options,
+                                           const std::vector<GLTextureAtlas::Region> *regions = nullptr);
+    // Map a container and upload it. Returns the texture, or 0 if the file is missing,
+    // corrupt or compressed in a format the driver lacks. regions receives the atlas table.
+    // A non-zero texture is re-specified in place instead of creating a new one.
+    DOTBLUE_API unsigned int LoadTextureContainer(const std::string &path, int *width = nullptr, int *height = nullptr,
+                                                  std::vector<GLTextureAtlas::Region> *regions = nullptr,
+                                                  unsigned int texture = 0);
+
+    // Internal: cache keys and paths
+    uint64_t HashTextureData(uint64_t hash, const void *data, size_t length);
+    uint64_t HashTextureSource(uint64_t hash, const std::string &path); // Path, size and mtime
+    std::string TextureCachePath(uint64_t key); // Empty when the cache is disabled
+    // Convert a freshly decoded source (a cache miss) into a container at path and upload
+    // it from there; 0 if that fails and the caller should upload the pixels itself
+    unsigned int StoreTextureCacheEntry(const std::string &path, const unsigned char *rgba, int width, int height,
+                                        const std::vector<GLTextureAtlas::Region> *regions = nullptr);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "GLPlatform.h"
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+
+namespace DotBlue
+{
+    // Texture loaded in the background by LoadTextureAsync().
+    //
+    // The image is decoded by stb_image as a JobSystem job. The engine then uploads it
+    // once per frame through pixel buffer objects, a band of rows at a time, never
+    // sending more than the per-frame upload budget (one band always goes through, so
+    // large images still make progress). Until every row is resident getTextureID()
+    // returns a shared 1x1 grey placeholder, so the handle can be drawn from the start.
+    class AsyncTexture
+    {
+    public:
+        enum class State
+        {
+            Decoding,  // Queued for or running on the job system
+            Uploading, // Decoded, rows being streamed into the texture
+            Ready,     // Fully resident
+            Failed     // File missing or not decodable (logged)
+        };
+
+        DOTBLUE_API ~AsyncTexture();
+
+        AsyncTexture(const AsyncTexture &) = delete;
+        AsyncTexture &operator=(const AsyncTexture &) = delete;
+
+        // The real texture once Ready, the placeholder before that (and after a failure).
+        // Marks the texture as used (see TouchTexture), so it may be bound directly.
+        DOTBLUE_API unsigned int getTextureID() const;
+        DOTBLUE_API State getState() const { return state.load(); }
+        DOTBLUE_API bool isReady() const { return state.load() == State::Ready; }
+        DOTBLUE_API const std::string &getFilename() const { return filename; }
+        // Image size; 0 until Ready (the decode thread fills it in before that)
+        DOTBLUE_API int getWidth() const { return isReady() ? width : 0; }
+        DOTBLUE_API int getHeight() const { return isReady() ? height : 0; }
+
+    private:
+        friend struct TextureLoader;
+
+        explicit AsyncTexture(const std::string &filename);
+
+        std::string filename;
+        std::atomic<State> state;
+        unsigned int textureID; // Allocated when the upload starts
+        int width, height;      // Published by the decode thread under the loader mutex
+        unsigned char *pixels;  // RGBA from stbi_load, freed once uploaded
+        int rowsUploaded;
+    };
+
+    using TextureHandle = std::shared_ptr<AsyncTexture>;
+
+    // Start loading an image file (anything stb_image reads) without blocking. Returns
+    // immediately; the handle is never null.
+    DOTBLUE_API TextureHandle LoadTextureAsync(const std::string &filename);
+
+    // Bytes of pixel data uploaded per frame (default 4 MB)
+    DOTBLUE_API void SetTextureUploadBudget(size_t bytesPerFrame);
+    // Textures not Ready or Failed yet
+    DOTBLUE_API size_t GetPendingTextureCount();
+    // Decode and upload everything queued right now (loading screens, shutdown)
+    DOTBLUE_API void FinishTextureLoads();
+
+    // Internal
+    void PumpTextureUploads(); // Called once per frame
+    void ShutdownTextureLoader();
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "GLPlatform.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace DotBlue
+{
+    // Texture residency manager.
+    //
+    // Every texture the engine creates (LoadPNGTexture, GLTextureAtlas, LoadTextureAsync,
+    // font glyph pages) is registered here with its GPU size, queried from GL. The engine
+    // marks textures as used when it binds them; once per frame, while the resident total
+    // is over the budget, the least recently used evictable textures have their storage
+    // replaced by a 1x1 placeholder. The GL name stays valid, so raw ids held by the game
+    // keep working: the next TouchTexture()/BindTexture() re-streams the image from its
+    // source (through the texture cache when it has an entry). Textures used in the
+    // current or previous frame are never evicted.
+    //
+    // Use is only seen through TouchTexture()/BindTexture(), so evictable ids must be bound
+    // that way: a texture bound with raw glBindTexture looks unused, gets evicted and
+    // stays the placeholder. Sampling state is saved at eviction and re-applied on restore,
+    // so change it only while the texture is resident (GLDisableTextureFiltering and
+    // GLEnableTextureFiltering bind through the registry first).
+
+    // Re-upload a texture's contents into the given (existing) texture name
+    using TextureRestoreFn = std::function<bool(unsigned int textureID)>;
+
+    struct TextureMemoryStats
+    {
+        size_t residentBytes = 0; // GPU memory held by registered textures
+        size_t peakBytes = 0;     // Highest residentBytes seen
+        size_t budgetBytes = 0;   // 0 = unlimited
+        unsigned int textures = 0;
+        unsigned int evicted = 0;   // Textures currently evicted
+        unsigned int evictions = 0; // Totals since start
+        unsigned int restores = 0;
+    };
+
+    struct TextureInfo
+    {
+        unsigned int textureID;
+        std::string name;
+        size_t bytes;           // Resident size, or the size it will have once restored
+        bool resident;
+        bool evictable;         // Has a source to re-stream from
+        uint64_t lastUsedFrame;
+    };
+
+    // Budget for registered textures in bytes (0, the default, disables eviction)
+    DOTBLUE_API void SetTextureMemoryBudget(size_t bytes);
+    DOTBLUE_API TextureMemoryStats GetTextureMemoryStats();
+    // All registered textures, largest first (for profiler overlays)
+    DOTBLUE_API std::vector<TextureInfo> GetTextureList();
+
+    // Mark a texture as used this frame, restoring it first if it was evicted. Unknown
+    // ids are ignored. BindTexture() also binds it to GL_TEXTURE_2D.
+    DOTBLUE_API void TouchTexture(unsigned int textureID);
+    DOTBLUE_API void BindTexture(unsigned int textureID);
+
+    // Track a texture created outside the engine. Without a restore function it is counted
+    // but never evicted; layered selects GL_TEXTURE_2D_ARRAY instead of GL_TEXTURE_2D
+    // (array textures are only accounted for, never evicted).
+    DOTBLUE_API void RegisterTexture(unsigned int textureID, const std::string &name,
+                                     TextureRestoreFn restore = nullptr, bool layered = false);
+    // Call before glDeleteTextures
+    DOTBLUE_API void UnregisterTexture(unsigned int textureID);
+    // Unregister and glDeleteTextures, e.g. for ids returned by LoadPNGTexture
+    DOTBLUE_API void DeleteTexture(unsigned int textureID);
+    // Re-query the size after the texture storage was re-specified
+    DOTBLUE_API void UpdateTextureSize(unsigned int textureID);
+
+    // Internal
+    void EnforceTextureBudget(); // Called once per frame
+    void ShutdownTextureRegistry();
+    // Decode (or map from the texture cache) an image file into an existing texture
+    bool ReloadTextureFile(const std::string &filename, unsigned int textureID);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "GLPlatform.h"
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+
+namespace DotBlue
+{
+    // Fixed pool of worker threads running CPU jobs (mesh building, decoding, ...).
+    //
+    // Jobs are plain functions taken from one FIFO queue. They must not touch GL; hand
+    // results back to the render thread instead. Threads waiting for their own jobs should
+    // help with runOne() rather than block, so waiting from inside a job cannot deadlock
+    // and the waiting thread adds its core to the pool.
+    class JobSystem
+    {
+    public:
+        // 0 threads = one per core, minus the calling (render) thread
+        DOTBLUE_API explicit JobSystem(unsigned int threads = 0);
+        // Runs everything still queued, then joins the workers
+        DOTBLUE_API ~JobSystem();
+
+        JobSystem(const JobSystem &) = delete;
+        JobSystem &operator=(const JobSystem &) = delete;
+
+        DOTBLUE_API void submit(std::function<void()> job);
+        // Run one queued job on the calling thread; false if the queue was empty
+        DOTBLUE_API bool runOne();
+        // Block (helping) until the queue is empty and no job is running
+        DOTBLUE_API void waitIdle();
+        // Run fn(i) for i in [0, count) across the pool and the calling thread
+        DOTBLUE_API void parallelFor(size_t count, const std::function<void(size_t)> &fn);
+
+        DOTBLUE_API unsigned int getThreadCount() const { return (unsigned int)workers.size(); }
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::deque<std::function<void()>> queue;
+        size_t running = 0;
+        bool stopping = false;
+
+        void workerLoop();
+        void finish(); // Called after each job with the mutex not held
+    };
+
+    // Engine-wide pool, created on first use
+    DOTBLUE_API JobSystem &GetJobSystem();
+    void ShutdownJobSystem(); // Internal
+}
@@ -47,10 +47,19 @@ namespace DotBlue
 
     void CallGameRender()
     {
+        // Finalize any shaders whose asynchronous compile has completed
+        PollPendingShaders();
+        // Stream decoded textures into GL under the per-frame upload budget
+        PumpTextureUploads();
+        // Evict least recently used textures while over the GPU memory budget
+        EnforceTextureBudget();
         if (g_gameRender)
         {
             g_gameRender();
         }
+        // Submit any 2D primitives the game queued this frame
+        FlushBatch2D();
+        StreamBufferEndFrame();
     }
 
     void CallGameShutdown()
@@ -0,0 +1,502 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iostream>
+#include "DotBlue/DotBlue.h"
+#include "DotBlue/GLPlatform.h"
+#include "DotBlue/GLBatch2D.h"
+
+namespace DotBlue
+{
+    // Upper bound on queued vertices before an automatic flush (per stream); keeps one
+    // flush well inside a single GLStreamBuffer region
+    static const size_t kMaxBatchVertices = 1 << 16;
+
+    static std::unique_ptr<Batch2D> g_batch2D = nullptr;
+
+    // No layout qualifiers so the same sources build as GLSL 1.30 (GL 3.0) and 1.50 core;
+    // attribute locations are queried after linking instead
+    static const char *textVertShader = R"(
+uniform mat4 u_projection;
+in vec2 a_position;
+in vec2 a_texcoord;
+in vec4 a_color;
+in vec4 a_outlineColor;
+in vec2 a_params;
+out vec2 v_texcoord;
+out vec4 v_color;
+out vec4 v_outlineColor;
+out vec2 v_params;
+void main() {
+    gl_Position = u_projection * vec4(a_position, 0.0, 1.0);
+    v_texcoord = a_texcoord;
+    v_color = a_color;
+    v_outlineColor = a_outlineColor;
+    v_params = a_params;
+}
+)";
+    static const char *textFragShader = R"(
+uniform sampler2D u_font;
+in vec2 v_texcoord;
+in vec4 v_color;
+out vec4 fragColor;
+void main() {
+    // Font textures are single-channel (GL_R8): coverage lives in .r
+    fragColor = vec4(v_color.rgb, v_color.a * texture(u_font, v_texcoord).r);
+}
+)";
+    static const char *sdfTextFragShader = R"(
+uniform sampler2D u_font;
+in vec2 v_texcoord;
+in vec4 v_color;
+in vec4 v_outlineColor;
+in vec2 v_params; // x = outline width, y = extra softness (distance units)
+out vec4 fragColor;
+void main() {
+    // Distance is 0.5 on the glyph edge and grows towards the inside
+    float d = texture(u_font, v_texcoord).r;
+    float w = 0.5 * fwidth(d) + v_params.y;
+    float fill = smoothstep(0.5 - w, 0.5 + w, d);
+    float outer = smoothstep(0.5 - v_params.x - w, 0.5 - v_params.x + w, d);
+    vec4 c = mix(v_outlineColor, v_color, fill);
+    fragColor = vec4(c.rgb, c.a * outer);
+}
+)";
+
+    static uint8_t toUnorm8(float v)
+    {
+        return (uint8_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    Batch2D::Batch2D()
+        : program(0), programCaptured(false), flushing(false), colorVAO(0), texturedVAO(0),
+          streamGeneration(0)
+    {
+    }
+
+    Batch2D::~Batch2D()
+    {
+        if (colorVAO)
+            glDeleteVertexArrays(1, &colorVAO);
+        if (texturedVAO)
+            glDeleteVertexArrays(1, &texturedVAO);
+        for (TextPipeline &pipeline : textPipelines)
+        {
+            if (pipeline.vao)
+                glDeleteVertexArrays(1, &pipeline.vao);
+        }
+    }
+
+    bool Batch2D::initTextPipeline(Format format)
+    {
+        TextPipeline &pipeline = textPipelines[format - FORMAT_TEXT];
+        if (pipeline.loaded || pipeline.failed)
+            return pipeline.loaded;
+
+        const char *version = GLEW_VERSION_3_2 ? "#version 150\n" : "#version 130\n";
+        const char *fragSource = format == FORMAT_SDF_TEXT ? sdfTextFragShader : textFragShader;
+        if (!pipeline.shader.load(std::string(version) + textVertShader, std::string(version) + fragSource))
+        {
+            std::cerr << "[Batch2D] " << (format == FORMAT_SDF_TEXT ? "SDF text" : "Text")
+                      << " shader failed to load, text will not be drawn" << std::endl;
+            pipeline.failed = true;
+            return false;
+        }
+        pipeline.projection = pipeline.shader.getUniform("u_projection");
+
+        // The sampler never changes; set it once with the program bound
+        GLint previousProgram = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+        glUseProgram(pipeline.shader.getProgram());
+        pipeline.shader.setInt(pipeline.shader.getUniform("u_font"), 0);
+        glUseProgram(previousProgram);
+
+        glGenVertexArrays(1, &pipeline.vao);
+        pipeline.loaded = true;
+        streamGeneration = 0; // Make initBuffers() point the new VAO as well
+        return true;
+    }
+
+    static void pointTextAttribute(unsigned int program, const char *name, GLint size, GLenum type,
+                                   GLboolean normalized, size_t offset, GLsizei stride)
+    {
+        GLint location = glGetAttribLocation(program, name);
+        if (location < 0)
+            return; // Optimized out of this program
+        glVertexAttribPointer(location, size, type, normalized, stride, (void *)offset);
+        glEnableVertexAttribArray(location);
+    }
+
+    void Batch2D::initBuffers(const GLStreamBuffer &stream)
+    {
+        if (colorVAO != 0 && streamGeneration == stream.getGeneration())
+            return;
+
+        // All VAOs source the shared stream buffer at offset 0; draws select their
+        // vertices through the `first` argument
+        if (colorVAO == 0)
+        {
+            glGenVertexArrays(1, &colorVAO);
+            glGenVertexArrays(1, &texturedVAO);
+        }
+        streamGeneration = stream.getGeneration();
+
+        glBindVertexArray(colorVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, stream.getBuffer());
+        // Position attribute (location = 0)
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(0);
+        // Color attribute (location = 1)
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        glBindVertexArray(texturedVAO);
+        // Position attribute (location = 0)
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(0);
+        // Texture coordinate attribute (location = 2)
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+
+        // Both text pipelines read the same TextVertex stream
+        const GLsizei stride = sizeof(TextVertex);
+        for (TextPipeline &pipeline : textPipelines)
+        {
+            if (!pipeline.loaded)
+                continue;
+            unsigned int textProgram = pipeline.shader.getProgram();
+            glBindVertexArray(pipeline.vao);
+            pointTextAttribute(textProgram, "a_position", 2, GL_FLOAT, GL_FALSE, offsetof(TextVertex, x), stride);
+            pointTextAttribute(textProgram, "a_texcoord", 2, GL_FLOAT, GL_FALSE, offsetof(TextVertex, u), stride);
+            pointTextAttribute(textProgram, "a_color", 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(TextVertex, r), stride);
+            pointTextAttribute(textProgram, "a_outlineColor", 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(TextVertex, outlineR), stride);
+            pointTextAttribute(textProgram, "a_params", 2, GL_FLOAT, GL_FALSE, offsetof(TextVertex, outlineWidth), stride);
+        }
+
+        glBindVertexArray(0);
+    }
+
+    void Batch2D::begin(size_t newVertices, bool usesCallerProgram)
+    {
+        if (!runs.empty() &&
+            (colorVertices.size() / 6 + newVertices > kMaxBatchVertices ||
+             texturedVertices.size() / 5 + newVertices > kMaxBatchVertices ||
+             textVertices.size() + newVertices > kMaxBatchVertices))
+        {
+            flush();
+        }
+        if (usesCallerProgram && !programCaptured)
+        {
+            // Capture the program once per batch; GLShader::bind() flushes us if it changes
+            GLint current = 0;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+            program = (unsigned int)current;
+            programCaptured = true;
+        }
+    }
+
+    void Batch2D::addRun(unsigned int mode, Format format, unsigned int textureID, size_t first, size_t count)
+    {
+        if (!runs.empty())
+        {
+            Run &last = runs.back();
+            if (last.mode == mode && last.format == format && last.textureID == textureID &&
+                last.first + last.count == first)
+            {
+                last.count += count;
+                return;
+            }
+        }
+        runs.push_back({mode, format, textureID, first, count});
+    }
+
+    void Batch2D::line(float x0, float y0, float x1, float y1, float r, float g, float b)
+    {
+        begin(2, true);
+        size_t first = colorVertices.size() / 6;
+        colorVertices.insert(colorVertices.end(), {
+            x0, y0, 0.0f, r, g, b,
+            x1, y1, 0.0f, r, g, b});
+        addRun(GL_LINES, FORMAT_COLOR, 0, first, 2);
+    }
+
+    void Batch2D::triangle(float x0, float y0, float x1, float y1, float x2, float y2, float r, float g, float b)
+    {
+        begin(3, true);
+        size_t first = colorVertices.size() / 6;
+        colorVertices.insert(colorVertices.end(), {
+            x0, y0, 0.0f, r, g, b,
+            x1, y1, 0.0f, r, g, b,
+            x2, y2, 0.0f, r, g, b});
+        addRun(GL_TRIANGLES, FORMAT_COLOR, 0, first, 3);
+    }
+
+    void Batch2D::rectangle(float x0, float y0, float x1, float y1, float r, float g, float b)
+    {
+        begin(6, true);
+        size_t first = colorVertices.size() / 6;
+        // Two triangles (0,1,2) (2,3,0) of the bottom-left, bottom-right, top-right, top-left quad
+        colorVertices.insert(colorVertices.end(), {
+            x0, y0, 0.0f, r, g, b,
+            x1, y0, 0.0f, r, g, b,
+            x1, y1, 0.0f, r, g, b,
+            x1, y1, 0.0f, r, g, b,
+            x0, y1, 0.0f, r, g, b,
+            x0, y0, 0.0f, r, g, b});
+        addRun(GL_TRIANGLES, FORMAT_COLOR, 0, first, 6);
+    }
+
+    void Batch2D::texturedQuad(unsigned int textureID, float x0, float y0, float x1, float y1,
+                               float u0, float v0, float u1, float v1)
+    {
+        begin(6, true);
+        size_t first = texturedVertices.size() / 5;
+        texturedVertices.insert(texturedVertices.end(), {
+            x0, y0, 0.0f, u0, v0,
+            x1, y0, 0.0f, u1, v0,
+            x1, y1, 0.0f, u1, v1,
+            x1, y1, 0.0f, u1, v1,
+            x0, y1, 0.0f, u0, v1,
+            x0, y0, 0.0f, u0, v0});
+        addRun(GL_TRIANGLES, FORMAT_TEXTURED, textureID, first, 6);
+    }
+
+    void Batch2D::texturedTriangle(unsigned int textureID,
+                                   float x0, float y0, float u0, float v0,
+                                   float x1, float y1, float u1, float v1,
+                                   float x2, float y2, float u2, float v2)
+    {
+        begin(3, true);
+        size_t first = texturedVertices.size() / 5;
+        texturedVertices.insert(texturedVertices.end(), {
+            x0, y0, 0.0f, u0, v0,
+            x1, y1, 0.0f, u1, v1,
+            x2, y2, 0.0f, u2, v2});
+        addRun(GL_TRIANGLES, FORMAT_TEXTURED, textureID, first, 3);
+    }
+
+    void Batch2D::pushText(Format format, unsigned int fontTexture, const stbtt_aligned_quad *quads, size_t count,
+                           const RGBA &color, const RGBA &outlineColor, float outlineWidth, float softness)
+    {
+        if (count == 0)
+            return;
+        begin(count * 6, false);
+        TextVertex v;
+        v.r = toUnorm8(color.r);
+        v.g = toUnorm8(color.g);
+        v.b = toUnorm8(color.b);
+        v.a = toUnorm8(color.a);
+        v.outlineR = toUnorm8(outlineColor.r);
+        v.outlineG = toUnorm8(outlineColor.g);
+        v.outlineB = toUnorm8(outlineColor.b);
+        v.outlineA = toUnorm8(outlineColor.a);
+        v.outlineWidth = outlineWidth;
+        v.softness = softness;
+
+        size_t first = textVertices.size();
+        textVertices.resize(first + count * 6);
+        TextVertex *out = &textVertices[first];
+        for (size_t i = 0; i < count; ++i)
+        {
+            // Two triangles (0,1,2) (2,3,0) per glyph
+            const stbtt_aligned_quad &q = quads[i];
+            const float corners[6][4] = {
+                {q.x0, q.y0, q.s0, q.t0},
+                {q.x1, q.y0, q.s1, q.t0},
+                {q.x1, q.y1, q.s1, q.t1},
+                {q.x1, q.y1, q.s1, q.t1},
+                {q.x0, q.y1, q.s0, q.t1},
+                {q.x0, q.y0, q.s0, q.t0}};
+            for (const float *c : corners)
+            {
+                v.x = c[0];
+                v.y = c[1];
+                v.u = c[2];
+                v.v = c[3];
+                *out++ = v;
+            }
+        }
+        addRun(GL_TRIANGLES, format, fontTexture, first, count * 6);
+    }
+
+    void Batch2D::text(unsigned int fontTexture, const stbtt_aligned_quad *quads, size_t count,
+                       const RGBA &color)
+    {
+        pushText(FORMAT_TEXT, fontTexture, quads, count, color, color, 0.0f, 0.0f);
+    }
+
+    void Batch2D::sdfText(unsigned int fontTexture, const stbtt_aligned_quad *quads, size_t count,
+                          const RGBA &color, const RGBA &outlineColor, float outlineWidth, float softness)
+    {
+        // Without an outline the edge blends into the fill color rather than the outline color
+        pushText(FORMAT_SDF_TEXT, fontTexture, quads, count, color,
+                 outlineWidth > 0.0f ? outlineColor : color, std::max(outlineWidth, 0.0f), std::max(softness, 0.0f));
+    }
+
+    void Batch2D::flush()
+    {
+        // GLShader hooks fire while we bind the text shader; never re-enter
+        if (runs.empty() || flushing)
+            return;
+        flushing = true;
+
+        bool textReady[2] = {false, false};
+        if (!textVertices.empty())
+        {
+            for (const Run &run : runs)
+            {
+                if (run.format >= FORMAT_TEXT)
+                    textReady[run.format - FORMAT_TEXT] = initTextPipeline(run.format);
+            }
+        }
+        bool hasText = textReady[0] || textReady[1];
+
+        GLStreamBuffer &stream = GetStreamBuffer();
+        const size_t colorStride = 6 * sizeof(float);
+        const size_t texturedStride = 5 * sizeof(float);
+        const size_t textStride = sizeof(TextVertex);
+        size_t colorBytes = colorVertices.size() * sizeof(float);
+        size_t texturedBytes = texturedVertices.size() * sizeof(float);
+        size_t textBytes = hasText ? textVertices.size() * textStride : 0;
+
+        // Write every stream before any draw, keeping them in the same buffer storage
+        stream.reserve(colorBytes + texturedBytes + textBytes + colorStride + texturedStride + textStride);
+        size_t colorBase = 0, texturedBase = 0, textBase = 0;
+        if (colorBytes)
+            colorBase = stream.write(colorVertices.data(), colorBytes, colorStride) / colorStride;
+        if (texturedBytes)
+            texturedBase = stream.write(texturedVertices.data(), texturedBytes, texturedStride) / texturedStride;
+        if (textBytes)
+            textBase = stream.write(textVertices.data(), textBytes, textStride) / textStride;
+        initBuffers(stream);
+
+        GLint previousProgram = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+        unsigned int boundProgram = (unsigned int)previousProgram;
+        unsigned int boundVAO = 0;
+        unsigned int boundTexture = 0;
+        bool textStateSet = false;
+        GLint viewport[4] = {0, 0, 0, 0};
+        // Caller state changed for text runs, restored below
+        GLboolean previousBlend = GL_FALSE, previousDepthTest = GL_FALSE;
+        GLint previousActiveTexture = GL_TEXTURE0;
+        GLint previousBlendFunc[4] = {GL_ONE, GL_ZERO, GL_ONE, GL_ZERO}; // src/dst RGB, src/dst alpha
+        for (const Run &run : runs)
+        {
+            unsigned int vao = colorVAO;
+            unsigned int runProgram = program;
+            size_t base = colorBase;
+            if (run.format == FORMAT_TEXTURED)
+            {
+                vao = texturedVAO;
+                base = texturedBase;
+            }
+            else if (run.format >= FORMAT_TEXT)
+            {
+                if (!textReady[run.format - FORMAT_TEXT])
+                    continue;
+                TextPipeline &pipeline = textPipelines[run.format - FORMAT_TEXT];
+                vao = pipeline.vao;
+                runProgram = pipeline.shader.getProgram();
+                base = textBase;
+            }
+
+            if (runProgram != boundProgram)
+            {
+                glUseProgram(runProgram);
+                boundProgram = runProgram;
+            }
+            if (run.format >= FORMAT_TEXT)
+            {
+                if (!textStateSet)
+                {
+                    // Text blends over the scene and ignores depth
+                    glGetIntegerv(GL_VIEWPORT, viewport);
+                    previousBlend = glIsEnabled(GL_BLEND);
+                    previousDepthTest = glIsEnabled(GL_DEPTH_TEST);
+                    glGetIntegerv(GL_ACTIVE_TEXTURE, &previousActiveTexture);
+                    glGetIntegerv(GL_BLEND_SRC_RGB, &previousBlendFunc[0]);
+                    glGetIntegerv(GL_BLEND_DST_RGB, &previousBlendFunc[1]);
+                    glGetIntegerv(GL_BLEND_SRC_ALPHA, &previousBlendFunc[2]);
+                    glGetIntegerv(GL_BLEND_DST_ALPHA, &previousBlendFunc[3]);
+                    glActiveTexture(GL_TEXTURE0);
+                    glEnable(GL_BLEND);
+                    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                    glDisable(GL_DEPTH_TEST);
+                    textStateSet = true;
+                }
+                // Elided by GLShader when the viewport has not changed
+                TextPipeline &pipeline = textPipelines[run.format - FORMAT_TEXT];
+                pipeline.shader.setMat4(pipeline.projection, glm::ortho(0.0f, (float)viewport[2], (float)viewport[3], 0.0f, -1.0f, 1.0f));
+            }
+            if (vao != boundVAO)
+            {
+                glBindVertexArray(vao);
+                boundVAO = vao;
+            }
+            if (run.format != FORMAT_COLOR && run.textureID != boundTexture)
+            {
+                BindTexture(run.textureID);
+                boundTexture = run.textureID;
+            }
+            glDrawArrays(run.mode, (GLint)(base + run.first), (GLsizei)run.count);
+            ++stats.drawCalls;
+        }
+        glBindVertexArray(0);
+
+        stats.vertices += colorVertices.size() / 6 + texturedVertices.size() / 5 + textVertices.size();
+        ++stats.flushes;
+
+        if (boundProgram != (unsigned int)previousProgram)
+            glUseProgram(previousProgram);
+        if (textStateSet)
+        {
+            glBlendFuncSeparate(previousBlendFunc[0], previousBlendFunc[1], previousBlendFunc[2], previousBlendFunc[3]);
+            if (!previousBlend)
+                glDisable(GL_BLEND);
+            if (previousDepthTest)
+                glEnable(GL_DEPTH_TEST);
+            glActiveTexture(previousActiveTexture);
+        }
+
+        colorVertices.clear();
+        texturedVertices.clear();
+        textVertices.clear();
+        runs.clear();
+        programCaptured = false;
+        flushing = false;
+    }
+
+    Batch2D &GetBatch2D()
+    {
+        if (!g_batch2D)
+            g_batch2D = std::make_unique<Batch2D>();
+        return *g_batch2D;
+    }
+
+    void FlushBatch2D()
+    {
+        if (g_batch2D)
+            g_batch2D->flush();
+    }
+
+    void Batch2DOnBindProgram(unsigned int program)
+    {
+        if (g_batch2D && g_batch2D->usesProgram() && g_batch2D->getProgram() != program)
+            g_batch2D->flush();
+    }
+
+    void Batch2DOnSetUniform(unsigned int program)
+    {
+        if (g_batch2D && g_batch2D->usesProgram() && g_batch2D->getProgram() == program)
+            g_batch2D->flush();
+    }
+
+    void ShutdownBatch2D()
+    {
+        g_batch2D.reset();
+    }
+}
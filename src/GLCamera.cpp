@@ -1,5 +1,6 @@
 #include "DotBlue/GLPlatform.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
 
 namespace DotBlue
 {
@@ -41,6 +42,106 @@ namespace DotBlue
         return glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane);
     }
 
+    GLFrustum GLCamera::getFrustum() const
+    {
+        return GLFrustum::fromMatrix(getProjectionMatrix() * getViewMatrix());
+    }
+
+    GLFrustum GLFrustum::fromMatrix(const glm::dmat4 &m)
+    {
+        // Gribb/Hartmann: each plane is the last row of the matrix plus or minus another row
+        // (glm is column-major, so row r is m[0][r], m[1][r], m[2][r], m[3][r])
+        auto row = [&m](int r) { return glm::dvec4(m[0][r], m[1][r], m[2][r], m[3][r]); };
+        const glm::dvec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+        GLFrustum frustum;
+        frustum.planes[0] = r3 + r0;
+        frustum.planes[1] = r3 - r0;
+        frustum.planes[2] = r3 + r1;
+        frustum.planes[3] = r3 - r1;
+        frustum.planes[4] = r3 + r2;
+        frustum.planes[5] = r3 - r2;
+        for (glm::dvec4 &plane : frustum.planes)
+        {
+            const double length = glm::length(glm::dvec3(plane));
+            if (length > 0.0)
+                plane /= length;
+        }
+        return frustum;
+    }
+
+    bool GLFrustum::intersectsSphere(const glm::dvec3 &center, double radius) const
+    {
+        for (const glm::dvec4 &plane : planes)
+        {
+            if (glm::dot(glm::dvec3(plane), center) + plane.w < -radius)
+                return false;
+        }
+        return true;
+    }
+
+    bool GLFrustum::intersectsAABB(const glm::dvec3 &boxMin, const glm::dvec3 &boxMax) const
+    {
+        const glm::dvec3 center = (boxMin + boxMax) * 0.5;
+        const glm::dvec3 extent = (boxMax - boxMin) * 0.5;
+        for (const glm::dvec4 &plane : planes)
+        {
+            // Distance of the box's most positive corner along the plane normal
+            const double reach = std::abs(plane.x) * extent.x + std::abs(plane.y) * extent.y + std::abs(plane.z) * extent.z;
+            if (glm::dot(glm::dvec3(plane), center) + plane.w < -reach)
+                return false;
+        }
+        return true;
+    }
+
+    size_t GLFrustum::cullBoxes(const GLBoundsBatch &boxes, std::vector<uint8_t> &visible) const
+    {
+        const size_t count = boxes.size();
+        visible.assign(count, 1);
+        const float *cx = boxes.centerX.data(), *cy = boxes.centerY.data(), *cz = boxes.centerZ.data();
+        const float *ex = boxes.extentX.data(), *ey = boxes.extentY.data(), *ez = boxes.extentZ.data();
+        uint8_t *out = visible.data();
+        for (const glm::dvec4 &plane : planes)
+        {
+            // Move the plane into the batch's frame in double, then test in float. The loop
+            // is branch-free over contiguous arrays so the compiler vectorises it.
+            const float nx = (float)plane.x, ny = (float)plane.y, nz = (float)plane.z;
+            const float ax = std::abs(nx), ay = std::abs(ny), az = std::abs(nz);
+            const float w = (float)(glm::dot(glm::dvec3(plane), boxes.origin) + plane.w);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const float distance = nx * cx[i] + ny * cy[i] + nz * cz[i] + w;
+                const float reach = ax * ex[i] + ay * ey[i] + az * ez[i];
+                out[i] &= (uint8_t)(distance + reach >= 0.0f);
+            }
+        }
+        size_t visibleCount = 0;
+        for (size_t i = 0; i < count; ++i)
+            visibleCount += out[i];
+        return visibleCount;
+    }
+
+    void GLBoundsBatch::clear()
+    {
+        centerX.clear();
+        centerY.clear();
+        centerZ.clear();
+        extentX.clear();
+        extentY.clear();
+        extentZ.clear();
+    }
+
+    void GLBoundsBatch::addBox(const glm::dvec3 &boxMin, const glm::dvec3 &boxMax)
+    {
+        const glm::dvec3 center = (boxMin + boxMax) * 0.5 - origin;
+        const glm::dvec3 extent = (boxMax - boxMin) * 0.5;
+        centerX.push_back((float)center.x);
+        centerY.push_back((float)center.y);
+        centerZ.push_back((float)center.z);
+        extentX.push_back((float)extent.x);
+        extentY.push_back((float)extent.y);
+        extentZ.push_back((float)extent.z);
+    }
+
     void GLCamera::move(const glm::dvec3 &delta)
     {
         position += delta;
@@ -0,0 +1,488 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include "DotBlue/DotBlue.h"
+#include "DotBlue/GLPlatform.h"
+#include "DotBlue/GLGlyphCache.h"
+#include "DotBlue/GLTextureRegistry.h"
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+namespace DotBlue
+{
+    // Empty texels right and below each glyph so linear filtering never picks up a neighbour
+    static const int kGlyphPadding = 1;
+
+    struct GLGlyphCache::Page
+    {
+        int size = 0;
+        std::vector<unsigned char> pixels;
+        stbrp_context packer;
+        std::vector<stbrp_node> nodes;
+        unsigned int textureID = 0;
+        int textureSize = 0;                                 // Size of the GPU storage, 0 before the first upload
+        int dirtyX0 = 0, dirtyY0 = 0, dirtyX1 = 0, dirtyY1 = 0; // Empty when x0 >= x1
+        uint64_t lastUsed = 0;
+
+        // Reset the packer; reserved x reserved in the top-left corner is kept occupied
+        void initPacker(int reserved)
+        {
+            nodes.resize(size);
+            stbrp_init_target(&packer, size, size, nodes.data(), (int)nodes.size());
+            if (reserved > 0)
+            {
+                // The first rect packed into an empty skyline always lands at (0, 0)
+                stbrp_rect old = {};
+                old.w = reserved;
+                old.h = reserved;
+                stbrp_pack_rects(&packer, &old, 1);
+            }
+        }
+
+        bool pack(int width, int height, int &x, int &y)
+        {
+            stbrp_rect rect = {};
+            rect.w = width;
+            rect.h = height;
+            if (!stbrp_pack_rects(&packer, &rect, 1) || !rect.was_packed)
+                return false;
+            x = rect.x;
+            y = rect.y;
+            return true;
+        }
+
+        void markDirty(int x0, int y0, int x1, int y1)
+        {
+            if (dirtyX0 >= dirtyX1)
+            {
+                dirtyX0 = x0;
+                dirtyY0 = y0;
+                dirtyX1 = x1;
+                dirtyY1 = y1;
+                return;
+            }
+            dirtyX0 = std::min(dirtyX0, x0);
+            dirtyY0 = std::min(dirtyY0, y0);
+            dirtyX1 = std::max(dirtyX1, x1);
+            dirtyY1 = std::max(dirtyY1, y1);
+        }
+    };
+
+    GLGlyphCache::GLGlyphCache(std::vector<unsigned char> &&ttfData, float pixelHeight, Mode mode, size_t budgetBytes)
+        : ttf(std::move(ttfData)), valid(false), mode(mode), pixelHeight(pixelHeight), scale(0.0f),
+          ascent(0.0f), descent(0.0f), lineGap(0.0f), budget(budgetBytes), useClock(0), generation(0), budgetWarned(false)
+    {
+        memset(&info, 0, sizeof(info));
+        if (ttf.empty())
+            return;
+        int offset = stbtt_GetFontOffsetForIndex(ttf.data(), 0);
+        if (offset < 0 || !stbtt_InitFont(&info, ttf.data(), offset))
+            return;
+
+        scale = stbtt_ScaleForPixelHeight(&info, pixelHeight);
+        int a, d, g;
+        stbtt_GetFontVMetrics(&info, &a, &d, &g);
+        ascent = a * scale;
+        descent = d * scale;
+        lineGap = g * scale;
+        valid = true;
+    }
+
+    GLGlyphCache::~GLGlyphCache()
+    {
+        for (auto &page : pages)
+        {
+            DeleteTexture(page->textureID);
+        }
+    }
+
+    size_t GLGlyphCache::textureBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto &page : pages)
+            bytes += (size_t)page->size * page->size;
+        return bytes;
+    }
+
+    void GLGlyphCache::updateStats()
+    {
+        stats.glyphs = glyphs.size();
+        stats.pages = pages.size();
+        stats.textureBytes = textureBytes();
+    }
+
+    void GLGlyphCache::newPage()
+    {
+        auto page = std::make_unique<Page>();
+        page->size = kInitialPageSize;
+        page->pixels.assign((size_t)page->size * page->size, 0);
+        page->initPacker(0);
+        pages.push_back(std::move(page));
+    }
+
+    void GLGlyphCache::growPage(Page &page)
+    {
+        // Quads already queued hold UVs normalized to the old size
+        FlushBatch2D();
+
+        int oldSize = page.size;
+        std::vector<unsigned char> old;
+        old.swap(page.pixels);
+        page.size = oldSize * 2;
+        page.pixels.assign((size_t)page.size * page.size, 0);
+        for (int row = 0; row < oldSize; ++row)
+            memcpy(&page.pixels[(size_t)row * page.size], &old[(size_t)row * oldSize], oldSize);
+        page.initPacker(oldSize);
+        // The texture is reallocated at the new size on the next upload()
+        page.markDirty(0, 0, page.size, page.size);
+        ++generation;
+    }
+
+    void GLGlyphCache::evictPage(int index)
+    {
+        // Queued quads may still sample the glyphs about to be overwritten
+        FlushBatch2D();
+
+        for (auto it = glyphs.begin(); it != glyphs.end();)
+        {
+            if (it->second.page == index)
+                it = glyphs.erase(it);
+            else
+                ++it;
+        }
+        Page &page = *pages[index];
+        std::fill(page.pixels.begin(), page.pixels.end(), 0);
+        page.initPacker(0);
+        page.markDirty(0, 0, page.size, page.size);
+        ++stats.evictions;
+        ++generation;
+    }
+
+    bool GLGlyphCache::allocate(int width, int height, int &page, int &x, int &y)
+    {
+        width += kGlyphPadding;
+        height += kGlyphPadding;
+        if (width > kMaxPageSize || height > kMaxPageSize)
+            return false;
+
+        // Newest pages first: older ones are usually full
+        for (int i = (int)pages.size() - 1; i >= 0; --i)
+        {
+            if (pages[i]->pack(width, height, x, y))
+            {
+                page = i;
+                return true;
+            }
+        }
+
+        // Grow the newest page while the budget allows; older pages stopped growing already
+        if (!pages.empty())
+        {
+            Page &last = *pages.back();
+            while (last.size < kMaxPageSize)
+            {
+                size_t extra = (size_t)last.size * last.size * 3; // (2n)^2 - n^2
+                if (textureBytes() + extra > budget)
+                    break;
+                growPage(last);
+                if (last.pack(width, height, x, y))
+                {
+                    page = (int)pages.size() - 1;
+                    return true;
+                }
+            }
+        }
+
+        if (textureBytes() + (size_t)kInitialPageSize * kInitialPageSize > budget)
+        {
+            // Over budget: recycle the least recently used page not needed by the current string
+            int lru = -1;
+            for (int i = 0; i < (int)pages.size(); ++i)
+            {
+                if (pages[i]->lastUsed < useClock && (lru < 0 || pages[i]->lastUsed < pages[lru]->lastUsed))
+                    lru = i;
+            }
+            if (lru >= 0)
+            {
+                evictPage(lru);
+                if (pages[lru]->pack(width, height, x, y))
+                {
+                    page = lru;
+                    return true;
+                }
+            }
+            if (!budgetWarned)
+            {
+                std::cerr << "[GLGlyphCache] Glyph budget of " << budget << " bytes exceeded" << std::endl;
+                budgetWarned = true;
+            }
+        }
+
+        newPage();
+        Page &fresh = *pages.back();
+        while (!fresh.pack(width, height, x, y))
+            growPage(fresh);
+        page = (int)pages.size() - 1;
+        return true;
+    }
+
+    const GLGlyphCache::Glyph *GLGlyphCache::getGlyph(uint32_t codepoint)
+    {
+        if (!valid)
+            return nullptr;
+
+        auto it = glyphs.find(codepoint);
+        if (it != glyphs.end())
+        {
+            if (it->second.page >= 0)
+                pages[it->second.page]->lastUsed = useClock;
+            return &it->second;
+        }
+
+        // Codepoints the font lacks map to glyph 0 (.notdef)
+        int index = stbtt_FindGlyphIndex(&info, (int)codepoint);
+        int advance, lsb;
+        stbtt_GetGlyphHMetrics(&info, index, &advance, &lsb);
+
+        Glyph glyph;
+        glyph.advance = advance * scale;
+        if (mode == Mode::SDF)
+        {
+            int width = 0, height = 0, xoff = 0, yoff = 0;
+            unsigned char *sdf = stbtt_GetGlyphSDF(&info, scale, index, kSDFPadding, (unsigned char)kSDFOnEdge,
+                                                   kSDFDistanceScale, &width, &height, &xoff, &yoff);
+            glyph.xoff = (float)xoff;
+            glyph.yoff = (float)yoff;
+            if (sdf && allocate(width, height, glyph.page, glyph.x, glyph.y))
+            {
+                Page &page = *pages[glyph.page];
+                for (int row = 0; row < height; ++row)
+                    memcpy(&page.pixels[(size_t)(glyph.y + row) * page.size + glyph.x], sdf + (size_t)row * width, width);
+                page.markDirty(glyph.x, glyph.y, glyph.x + width, glyph.y + height);
+                page.lastUsed = useClock;
+                glyph.width = width;
+                glyph.height = height;
+            }
+            if (sdf)
+                stbtt_FreeSDF(sdf, nullptr);
+        }
+        else
+        {
+            int x0, y0, x1, y1;
+            stbtt_GetGlyphBitmapBox(&info, index, scale, scale, &x0, &y0, &x1, &y1);
+            glyph.xoff = (float)x0;
+            glyph.yoff = (float)y0;
+            int width = x1 - x0, height = y1 - y0;
+            if (width > 0 && height > 0 && allocate(width, height, glyph.page, glyph.x, glyph.y))
+            {
+                Page &page = *pages[glyph.page];
+                stbtt_MakeGlyphBitmap(&info, &page.pixels[(size_t)glyph.y * page.size + glyph.x],
+                                      width, height, page.size, scale, scale, index);
+                page.markDirty(glyph.x, glyph.y, glyph.x + width, glyph.y + height);
+                page.lastUsed = useClock;
+                glyph.width = width;
+                glyph.height = height;
+            }
+        }
+        if (glyph.width == 0)
+            glyph.page = -1;
+        ++stats.rasterized;
+
+        Glyph &stored = glyphs[codepoint];
+        stored = glyph;
+        updateStats();
+        return &stored;
+    }
+
+    void GLGlyphCache::upload()
+    {
+        bool any = false;
+        for (auto &pagePtr : pages)
+        {
+            Page &page = *pagePtr;
+            if (page.dirtyX0 >= page.dirtyX1 && page.textureSize == page.size)
+                continue;
+            if (!any)
+            {
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                any = true;
+            }
+
+            if (!page.textureID)
+            {
+                glGenTextures(1, &page.textureID);
+                glBindTexture(GL_TEXTURE_2D, page.textureID);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            }
+            else
+            {
+                glBindTexture(GL_TEXTURE_2D, page.textureID);
+            }
+
+            if (page.textureSize != page.size)
+            {
+                // Single-channel coverage in .r; GL_ALPHA textures do not exist in core profiles
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, page.size, page.size, 0, GL_RED, GL_UNSIGNED_BYTE, page.pixels.data());
+                // Glyph pages are rasterized incrementally, so they are accounted for but never evicted
+                if (page.textureSize == 0)
+                    RegisterTexture(page.textureID, "glyph page");
+                else
+                    UpdateTextureSize(page.textureID);
+                page.textureSize = page.size;
+                stats.uploadBytes += (size_t)page.size * page.size;
+            }
+            else
+            {
+                int width = page.dirtyX1 - page.dirtyX0;
+                int height = page.dirtyY1 - page.dirtyY0;
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, page.size);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, page.dirtyX0, page.dirtyY0, width, height, GL_RED, GL_UNSIGNED_BYTE,
+                                &page.pixels[(size_t)page.dirtyY0 * page.size + page.dirtyX0]);
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+                stats.uploadBytes += (size_t)width * height;
+            }
+            page.dirtyX0 = page.dirtyY0 = page.dirtyX1 = page.dirtyY1 = 0;
+        }
+        if (any)
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    void GLGlyphCache::buildQuads(const char *utf8, float &x, float y,
+                                  std::vector<stbtt_aligned_quad> &quads, std::vector<unsigned int> &textures,
+                                  float size)
+    {
+        if (!valid)
+            return;
+        const float k = size > 0.0f ? size / pixelHeight : 1.0f;
+
+        // Resolve every glyph first: rasterizing one may grow a page, which changes the UVs
+        // of glyphs already placed on it
+        beginUse();
+        placed.clear();
+        const char *text = utf8;
+        while (*text)
+        {
+            uint32_t codepoint = DecodeUTF8(text);
+            if (codepoint < 32)
+                continue;
+            const Glyph *glyph = getGlyph(codepoint);
+            if (glyph->page >= 0)
+                placed.push_back({glyph, x});
+            x += glyph->advance * k;
+        }
+        upload();
+
+        for (const PlacedGlyph &p : placed)
+        {
+            quads.push_back(makeQuad(*p.glyph, p.x, y, size));
+            textures.push_back(pages[p.glyph->page]->textureID);
+        }
+    }
+
+    stbtt_aligned_quad GLGlyphCache::makeQuad(const Glyph &g, float penX, float baseline, float size) const
+    {
+        const float k = size > 0.0f ? size / pixelHeight : 1.0f;
+        const float inv = g.page >= 0 ? 1.0f / pages[g.page]->size : 0.0f;
+        float rx = penX + g.xoff * k;
+        float ry = baseline + g.yoff * k;
+        if (mode == Mode::Bitmap && k == 1.0f)
+        {
+            // Whole pixels like stbtt_GetBakedQuad so unscaled bitmap glyphs stay crisp
+            rx = std::floor(rx + 0.5f);
+            ry = std::floor(ry + 0.5f);
+        }
+        stbtt_aligned_quad q;
+        q.x0 = rx;
+        q.y0 = ry;
+        q.x1 = rx + g.width * k;
+        q.y1 = ry + g.height * k;
+        q.s0 = g.x * inv;
+        q.t0 = g.y * inv;
+        q.s1 = (g.x + g.width) * inv;
+        q.t1 = (g.y + g.height) * inv;
+        return q;
+    }
+
+    void GLGlyphCache::touchPage(int page)
+    {
+        if (page >= 0 && page < (int)pages.size())
+            pages[page]->lastUsed = useClock;
+    }
+
+    float GLGlyphCache::sdfDistance(float pixels, float size) const
+    {
+        // Screen pixels -> reference-size texels -> stored distance steps (0..1 range)
+        float k = size > 0.0f ? size / pixelHeight : 1.0f;
+        float distance = pixels / k * kSDFDistanceScale / 255.0f;
+        const float limit = kSDFOnEdge / 255.0f * 0.95f;
+        return std::min(std::max(distance, 0.0f), limit);
+    }
+
+    unsigned int GLGlyphCache::getPageTexture(int page) const
+    {
+        if (page < 0 || page >= (int)pages.size())
+            return 0;
+        return pages[page]->textureID;
+    }
+
+    uint32_t DecodeUTF8(const char *&text)
+    {
+        const unsigned char *s = (const unsigned char *)text;
+        uint32_t c = s[0];
+        int length = 1;
+        uint32_t minimum = 0;
+        if (c < 0x80)
+        {
+            text += 1;
+            return c;
+        }
+        else if ((c & 0xE0) == 0xC0)
+        {
+            c &= 0x1F;
+            length = 2;
+            minimum = 0x80;
+        }
+        else if ((c & 0xF0) == 0xE0)
+        {
+            c &= 0x0F;
+            length = 3;
+            minimum = 0x800;
+        }
+        else if ((c & 0xF8) == 0xF0)
+        {
+            c &= 0x07;
+            length = 4;
+            minimum = 0x10000;
+        }
+        else
+        {
+            text += 1;
+            return 0xFFFD;
+        }
+
+        for (int i = 1; i < length; ++i)
+        {
+            if ((s[i] & 0xC0) != 0x80)
+            {
+                // Truncated sequence: resume at the offending byte
+                text += i;
+                return 0xFFFD;
+            }
+            c = (c << 6) | (s[i] & 0x3F);
+        }
+        text += length;
+        if (c < minimum || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+            return 0xFFFD;
+        return c;
+    }
+}
@@ -75,6 +75,20 @@ namespace DotBlue
         // Shutdown input system
         ShutdownInput();
 
+        // Cached layouts hold fonts only weakly, but drop them before the fonts go
+        ShutdownTextLayoutCache();
+
+        // Finish queued jobs and join the job workers
+        ShutdownJobSystem();
+
+        // Release the upload buffer and placeholder (pending decodes ran above)
+        ShutdownTextureLoader();
+        ShutdownTextureRegistry();
+
+        // Release the 2D batch buffers while the GL context is still current
+        ShutdownBatch2D();
+        ShutdownStreamBuffer();
+
         // Clean up SDL audio
         Mix_CloseAudio();
         SDL_Quit();
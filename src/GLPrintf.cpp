@@ -12,6 +12,7 @@
 #undef UNICODE
 #undef _UNICODE
 #elif defined(__linux__) || defined(__FreeBSD__)
+#include <GL/glew.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <GL/glx.h>
@@ -28,14 +29,18 @@
 #include <cstdio>
 #include <utility>
 #include <string>
+#include <cstring>
 #include "DotBlue/stb_image.h"
+#include "DotBlue/GLBatch2D.h"
+#include "DotBlue/GLGlyphCache.h"
+#include "DotBlue/GLTextLayout.h"
 
 namespace DotBlue
 {
 
-    GLFont LoadFont(const char *fontPath, float pixelHeight)
+    static GLFont loadFontFile(const char *fontPath, float pixelHeight, GLGlyphCache::Mode mode)
     {
-        GLFont font = {};
+        GLFont font;
 
         std::ifstream file(fontPath, std::ios::binary);
         std::vector<unsigned char> ttfBuffer((std::istreambuf_iterator<char>(file)), {});
@@ -46,76 +51,141 @@ namespace DotBlue
             return font; // Return empty font, nothing will render
         }
 
-        const int texWidth = 512, texHeight = 512;
-        std::vector<unsigned char> bitmap(texWidth * texHeight);
+        // Glyphs are rasterized into the cache's atlas pages the first time they are drawn
+        auto glyphs = std::make_shared<GLGlyphCache>(std::move(ttfBuffer), pixelHeight, mode);
+        if (!glyphs->isValid())
+        {
+            std::cerr << "stbtt_InitFont failed for font: " << fontPath << std::endl;
+            return font;
+        }
+        font.glyphs = glyphs;
+        std::cout << "Loaded " << (mode == GLGlyphCache::Mode::SDF ? "SDF " : "") << "font from " << fontPath << std::endl;
+        return font;
+    }
 
-        int bakeResult = stbtt_BakeFontBitmap(
-            ttfBuffer.data(), 0, pixelHeight,
-            bitmap.data(), texWidth, texHeight,
-            32, 96, font.cdata);
+    GLFont LoadFont(const char *fontPath, float pixelHeight)
+    {
+        return loadFontFile(fontPath, pixelHeight, GLGlyphCache::Mode::Bitmap);
+    }
+
+    GLFont LoadFontSDF(const char *fontPath, float referenceHeight)
+    {
+        return loadFontFile(fontPath, referenceHeight, GLGlyphCache::Mode::SDF);
+    }
 
-        if (bakeResult <= 0)
+    // Queue laid-out glyph quads into the 2D batch, one run per atlas page; consecutive
+    // strings in the same font and style share one draw call
+    static void queueQuads(GLGlyphCache &glyphs, const std::vector<stbtt_aligned_quad> &quads,
+                           const std::vector<unsigned int> &textures, float size, const RGBA &color,
+                           const TextStyle *style)
+    {
+        static std::vector<stbtt_aligned_quad> shadow;
+        if (quads.empty())
+            return;
+
+        const bool sdf = glyphs.isSDF();
+        float outline = 0.0f;
+        if (sdf && style)
+            outline = glyphs.sdfDistance(style->outlineWidth, size);
+
+        Batch2D &batch = GetBatch2D();
+        auto queueRuns = [&](const std::vector<stbtt_aligned_quad> &source, const RGBA &fill, const RGBA &edge, float softness)
         {
-            std::cerr << "stbtt_BakeFontBitmap failed for font: " << fontPath << std::endl;
-            return font;
+            size_t first = 0;
+            for (size_t i = 1; i <= source.size(); ++i)
+            {
+                if (i < source.size() && textures[i] == textures[first])
+                    continue;
+                if (sdf)
+                    batch.sdfText(textures[first], &source[first], i - first, fill, edge, outline, softness);
+                else
+                    batch.text(textures[first], &source[first], i - first, fill);
+                first = i;
+            }
+        };
+
+        if (style && (style->shadowOffsetX != 0.0f || style->shadowOffsetY != 0.0f))
+        {
+            // Shadow first so the text lands on top; it takes the outline's extent too
+            shadow = quads;
+            for (stbtt_aligned_quad &q : shadow)
+            {
+                q.x0 += style->shadowOffsetX;
+                q.x1 += style->shadowOffsetX;
+                q.y0 += style->shadowOffsetY;
+                q.y1 += style->shadowOffsetY;
+            }
+            float softness = sdf ? glyphs.sdfDistance(style->shadowSoftness, size) : 0.0f;
+            queueRuns(shadow, style->shadowColor, style->shadowColor, softness);
         }
+        queueRuns(quads, color, style ? style->outlineColor : color, 0.0f);
+    }
 
-        font.width = texWidth;
-        font.height = texHeight;
-
-        glGenTextures(1, &font.textureID);
-        glBindTexture(GL_TEXTURE_2D, font.textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, texWidth, texHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, bitmap.data());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        std::cout << "Loaded font from " << fontPath << std::endl;
-        std::cout << "Font texture ID: " << font.textureID << std::endl;
-        std::cout << "Bitmap sample: " << (int)bitmap[0] << ", " << (int)bitmap[1] << std::endl;
-        std::cout << "Font buffer size: " << ttfBuffer.size() << std::endl;
-        std::cout << "Bake result: " << bakeResult << std::endl;
-        return font;
+    // Reused across calls to avoid per-string allocations
+    static std::vector<stbtt_aligned_quad> g_textQuads;
+    static std::vector<unsigned int> g_textTextures;
+
+    static void queueText(const GLFont &font, float x, float y, const RGBA &color, const TextStyle *style,
+                          const char *text)
+    {
+        float size = style ? style->size : 0.0f;
+        g_textQuads.clear();
+        g_textTextures.clear();
+        font.glyphs->buildQuads(text, x, y, g_textQuads, g_textTextures, size);
+        queueQuads(*font.glyphs, g_textQuads, g_textTextures, size, color, style);
+    }
+
+    // Draw a prebuilt layout; its own size wins over style->size
+    static void queueLayout(const TextLayout &layout, float x, float y, const RGBA &color, const TextStyle *style)
+    {
+        std::shared_ptr<GLGlyphCache> glyphs = layout.getFont();
+        if (!glyphs)
+            return;
+        g_textQuads.clear();
+        g_textTextures.clear();
+        if (!layout.getQuads(x, y, g_textQuads, g_textTextures))
+            return;
+        queueQuads(*glyphs, g_textQuads, g_textTextures, layout.getSize(), color, style);
     }
 
     void GLPrintf(const GLFont &font, float x, float y,
                   const RGBA &color, const char *fmt, ...)
     {
+        if (!font.glyphs)
+            return;
+
         char buffer[1024];
         va_list args;
         va_start(args, fmt);
         vsnprintf(buffer, sizeof(buffer), fmt, args);
         va_end(args);
 
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, font.textureID);
-        glColor4f(color.r, color.g, color.b, color.a);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDisable(GL_DEPTH_TEST);
-        glBegin(GL_QUADS);
-        const char *text = buffer;
-        while (*text)
-        {
-            if (*text >= 32 && *text < 128)
-            {
-                stbtt_aligned_quad q;
-                stbtt_GetBakedQuad(font.cdata, font.width, font.height, *text - 32, &x, &y, &q, 1);
-                glTexCoord2f(q.s0, q.t0);
-                glVertex2f(q.x0, q.y0);
-                glTexCoord2f(q.s1, q.t0);
-                glVertex2f(q.x1, q.y0);
-                glTexCoord2f(q.s1, q.t1);
-                glVertex2f(q.x1, q.y1);
-                glTexCoord2f(q.s0, q.t1);
-                glVertex2f(q.x0, q.y1);
-            }
-            ++text;
-        }
-        glEnd();
-        GLenum err = glGetError();
-        if (err != GL_NO_ERROR)
-            std::cout << "OpenGL error: " << err << std::endl;
+        queueText(font, x, y, color, nullptr, buffer);
+    }
+
+    void GLPrintfStyled(const GLFont &font, float x, float y, const RGBA &color, const TextStyle &style,
+                        const char *fmt, ...)
+    {
+        if (!font.glyphs)
+            return;
+
+        char buffer[1024];
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(buffer, sizeof(buffer), fmt, args);
+        va_end(args);
+
+        queueText(font, x, y, color, &style, buffer);
+    }
+
+    void GLPrintf(const TextLayout &layout, float x, float y, const RGBA &color)
+    {
+        queueLayout(layout, x, y, color, nullptr);
+    }
+
+    void GLPrintfStyled(const TextLayout &layout, float x, float y, const RGBA &color, const TextStyle &style)
+    {
+        queueLayout(layout, x, y, color, &style);
     }
 
     void PrintOpenGLInfo()
@@ -123,21 +193,36 @@ namespace DotBlue
         std::cout << "OpenGL version: " << glGetString(GL_VERSION) << std::endl;
     }
 
-    float GetCharWidth(const GLFont &font, char c)
+    float GetGlyphWidth(const GLFont &font, uint32_t codepoint)
     {
-        if (c < 32 || c > 126)
+        if (!font.glyphs || codepoint < 32)
             return 0.0f;
-        return font.cdata[c - 32].xadvance;
+        const GLGlyphCache::Glyph *glyph = font.glyphs->getGlyph(codepoint);
+        return glyph ? glyph->advance : 0.0f;
     }
 
-    float GetCharHeight(const GLFont &font, char c)
+    float GetGlyphHeight(const GLFont &font, uint32_t codepoint)
     {
-        if (c < 32 || c > 126)
+        if (!font.glyphs || codepoint < 32)
             return 0.0f;
-        stbtt_aligned_quad q;
-        float x = 0.0f, y = 0.0f;
-        stbtt_GetBakedQuad(font.cdata, font.width, font.height, c - 32, &x, &y, &q, 1);
-        return q.y1 - q.y0;
+        const GLGlyphCache::Glyph *glyph = font.glyphs->getGlyph(codepoint);
+        return glyph ? (float)glyph->height : 0.0f;
+    }
+
+    unsigned int GLFont::getTextureID() const
+    {
+        return glyphs ? glyphs->getPageTexture(0) : 0;
+    }
+
+    // A byte >= 0x80 is part of a UTF-8 sequence, not a Latin-1 character
+    float GetCharWidth(const GLFont &font, char c)
+    {
+        return (unsigned char)c < 0x80 ? GetGlyphWidth(font, (unsigned char)c) : 0.0f;
+    }
+
+    float GetCharHeight(const GLFont &font, char c)
+    {
+        return (unsigned char)c < 0x80 ? GetGlyphHeight(font, (unsigned char)c) : 0.0f;
     }
 
     std::pair<float, float> GetStringDimensions(const GLFont &font,
@@ -145,14 +230,18 @@ namespace DotBlue
     {
         float width = 0.0f;
         float maxHeight = 0.0f;
-        for (char c : str)
+        if (!font.glyphs)
+            return {width, maxHeight};
+        const char *text = str.c_str();
+        while (*text)
         {
-            if (c < 32 || c > 126)
+            uint32_t codepoint = DecodeUTF8(text);
+            if (codepoint < 32)
                 continue;
-            width += font.cdata[c - 32].xadvance;
-            float charHeight = GetCharHeight(font, c);
-            if (charHeight > maxHeight)
-                maxHeight = charHeight;
+            const GLGlyphCache::Glyph *glyph = font.glyphs->getGlyph(codepoint);
+            width += glyph->advance;
+            if (glyph->height > maxHeight)
+                maxHeight = (float)glyph->height;
         }
         return {width, maxHeight};
     }
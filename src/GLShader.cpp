@@ -10,13 +10,209 @@
 #include <utility>
 #include <string>
 #include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <filesystem>
+#include <algorithm>
 #include "DotBlue/DotBlue.h"
 #include "DotBlue/GLPlatform.h"
+#include "DotBlue/GLBatch2D.h"
 
 namespace DotBlue
 {
+    // Program binary cache. Programs are keyed by a hash of their sources and of the
+    // driver's vendor/renderer/version strings, so a driver update simply misses.
+    static std::string g_shaderCacheDir;
+    static bool g_shaderCacheDirSet = false;
+    static ShaderCacheStats g_shaderCacheStats;
 
-    GLShader::GLShader() : programID(0) {}
+    static const uint32_t kShaderCacheMagic = 0x43534244; // "DBSC"
+    static const uint32_t kShaderCacheVersion = 1;
+
+    void SetShaderCacheDirectory(const std::string &dir)
+    {
+        g_shaderCacheDir = dir;
+        g_shaderCacheDirSet = true;
+    }
+
+    const std::string &GetShaderCacheDirectory()
+    {
+        if (!g_shaderCacheDirSet)
+        {
+            std::error_code ec;
+            std::filesystem::path tmp = std::filesystem::temp_directory_path(ec);
+            g_shaderCacheDir = ec ? std::string() : (tmp / "dotblue_shadercache").string();
+            g_shaderCacheDirSet = true;
+        }
+        return g_shaderCacheDir;
+    }
+
+    ShaderCacheStats GetShaderCacheStats()
+    {
+        return g_shaderCacheStats;
+    }
+
+    static bool programBinarySupported()
+    {
+        if (!(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+            return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    static uint64_t fnv1a(uint64_t hash, const char *data, size_t length)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static std::string shaderCachePath(const std::string &vertexSrc, const std::string &fragmentSrc)
+    {
+        const std::string &dir = GetShaderCacheDirectory();
+        if (dir.empty() || !programBinarySupported())
+            return std::string();
+
+        uint64_t hash = 14695981039346656037ull;
+        const GLenum driverStrings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+        for (GLenum name : driverStrings)
+        {
+            const char *str = (const char *)glGetString(name);
+            if (str)
+                hash = fnv1a(hash, str, strlen(str) + 1);
+        }
+        hash = fnv1a(hash, vertexSrc.c_str(), vertexSrc.size() + 1);
+        hash = fnv1a(hash, fragmentSrc.c_str(), fragmentSrc.size() + 1);
+
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+        return (std::filesystem::path(dir) / name).string();
+    }
+
+    // Returns a linked program, or 0 when there is no usable cache entry
+    static unsigned int loadProgramBinary(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return 0;
+        uint32_t header[4] = {0, 0, 0, 0}; // magic, version, format, length
+        file.read((char *)header, sizeof(header));
+        if (!file || header[0] != kShaderCacheMagic || header[1] != kShaderCacheVersion || header[3] == 0)
+            return 0;
+        // The length comes from disk: it must match the file before anything is allocated
+        std::error_code sizeError;
+        const uintmax_t fileSize = std::filesystem::file_size(path, sizeError);
+        if (sizeError || header[3] > (uint32_t)INT_MAX || fileSize != sizeof(header) + (uintmax_t)header[3])
+        {
+            std::cerr << "[GLShader] Discarding corrupt program binary cache entry: " << path << std::endl;
+            file.close();
+            std::filesystem::remove(path, sizeError);
+            ++g_shaderCacheStats.stale;
+            return 0;
+        }
+        std::vector<char> binary(header[3]);
+        file.read(binary.data(), binary.size());
+        if (!file)
+            return 0;
+
+        unsigned int program = glCreateProgram();
+        glProgramBinary(program, (GLenum)header[2], binary.data(), (GLsizei)binary.size());
+        int status = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (!status)
+        {
+            // Driver rejected the binary (stale format): drop it and recompile
+            glDeleteProgram(program);
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            ++g_shaderCacheStats.stale;
+            return 0;
+        }
+        return program;
+    }
+
+    static void storeProgramBinary(const std::string &path, unsigned int program)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, &length, &format, binary.data());
+        if (length <= 0)
+            return;
+
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+        // Write to a temporary name first so a crash never leaves a truncated entry
+        std::string tmpPath = path + ".tmp";
+        bool written = false;
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                std::cerr << "[GLShader] Failed to write program binary cache: " << tmpPath << std::endl;
+                return;
+            }
+            uint32_t header[4] = {kShaderCacheMagic, kShaderCacheVersion, (uint32_t)format, (uint32_t)length};
+            file.write((const char *)header, sizeof(header));
+            file.write(binary.data(), length);
+            file.flush();
+            written = (bool)file;
+        }
+        if (written)
+            std::filesystem::rename(tmpPath, path, ec);
+        if (!written || ec)
+        {
+            std::cerr << "[GLShader] Failed to write program binary cache: " << path << std::endl;
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+        ++g_shaderCacheStats.stores;
+    }
+
+    // Shaders started with loadAsync() that have not been finalized yet
+    static std::vector<GLShader *> g_pendingShaders;
+    static uint64_t g_shaderFrame = 0;
+    static bool g_parallelCompileConfigured = false;
+
+    static bool parallelCompileSupported()
+    {
+#ifdef GL_KHR_parallel_shader_compile
+        if (!GLEW_KHR_parallel_shader_compile)
+            return false;
+        if (!g_parallelCompileConfigured)
+        {
+            // Let the driver use as many compiler threads as it likes
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+            g_parallelCompileConfigured = true;
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static bool checkShaderStatus(unsigned int shader)
+    {
+        int status = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (!status)
+        {
+            char log[512];
+            glGetShaderInfoLog(shader, 512, nullptr, log);
+            std::cerr << "Shader compile error: " << log << std::endl;
+        }
+        return status != 0;
+    }
+
+    GLShader::GLShader() : programID(0), state(State::Empty), pendingVS(0), pendingFS(0), pendingFrame(0) {}
 
     GLShader::~GLShader()
     {
@@ -25,63 +221,260 @@ namespace DotBlue
 
     void GLShader::deleteProgram()
     {
+        if (state == State::Pending)
+        {
+            glDeleteShader(pendingVS);
+            glDeleteShader(pendingFS);
+            pendingVS = pendingFS = 0;
+            g_pendingShaders.erase(std::remove(g_pendingShaders.begin(), g_pendingShaders.end(), this), g_pendingShaders.end());
+        }
         if (programID)
         {
+            Batch2DOnSetUniform(programID); // Draw anything still queued against this program
             glDeleteProgram(programID);
             programID = 0;
         }
+        state = State::Empty;
+        uniformSlots.clear();
+        slots.clear();
     }
 
     unsigned int GLShader::compileShader(unsigned int type, const std::string &src)
     {
+        // Status is checked when the program is finalized, so the driver can compile
+        // in the background in the meantime
         unsigned int shader = glCreateShader(type);
         const char *csrc = src.c_str();
         glShaderSource(shader, 1, &csrc, nullptr);
         glCompileShader(shader);
-
-        int status = 0;
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-        if (!status)
-        {
-            char log[512];
-            glGetShaderInfoLog(shader, 512, nullptr, log);
-            std::cerr << "Shader compile error: " << log << std::endl;
-            glDeleteShader(shader);
-            return 0;
-        }
         return shader;
     }
 
     bool GLShader::load(const std::string &vertexSrc, const std::string &fragmentSrc)
+    {
+        if (!loadAsync(vertexSrc, fragmentSrc))
+            return false;
+        return wait();
+    }
+
+    bool GLShader::loadAsync(const std::string &vertexSrc, const std::string &fragmentSrc)
     {
         deleteProgram();
 
-        unsigned int vs = compileShader(GL_VERTEX_SHADER, vertexSrc);
-        unsigned int fs = compileShader(GL_FRAGMENT_SHADER, fragmentSrc);
-        if (!vs || !fs)
+        pendingCachePath = shaderCachePath(vertexSrc, fragmentSrc);
+        if (!pendingCachePath.empty())
+        {
+            programID = loadProgramBinary(pendingCachePath);
+            if (programID)
+            {
+                ++g_shaderCacheStats.hits;
+                reflectUniforms();
+                state = State::Ready;
+                return true;
+            }
+            ++g_shaderCacheStats.misses;
+        }
+
+        pendingVS = compileShader(GL_VERTEX_SHADER, vertexSrc);
+        pendingFS = compileShader(GL_FRAGMENT_SHADER, fragmentSrc);
+        if (!pendingVS || !pendingFS)
+        {
+            if (pendingVS)
+                glDeleteShader(pendingVS);
+            if (pendingFS)
+                glDeleteShader(pendingFS);
+            pendingVS = pendingFS = 0;
+            state = State::Failed;
             return false;
+        }
 
         programID = glCreateProgram();
-        glAttachShader(programID, vs);
-        glAttachShader(programID, fs);
+        glAttachShader(programID, pendingVS);
+        glAttachShader(programID, pendingFS);
+        if (!pendingCachePath.empty())
+            glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(programID);
 
+        state = State::Pending;
+        pendingFrame = g_shaderFrame;
+        g_pendingShaders.push_back(this);
+        return true;
+    }
+
+    bool GLShader::poll()
+    {
+        if (state != State::Pending)
+            return state == State::Ready;
+#ifdef GL_KHR_parallel_shader_compile
+        if (parallelCompileSupported())
+        {
+            int done = 0;
+            glGetProgramiv(programID, GL_COMPLETION_STATUS_KHR, &done);
+            if (!done)
+                return false;
+            return finishPending();
+        }
+#endif
+        // Without the extension any status query blocks, so leave the driver at least
+        // until the next frame before asking
+        if (pendingFrame == g_shaderFrame)
+            return false;
+        return finishPending();
+    }
+
+    bool GLShader::wait()
+    {
+        if (state != State::Pending)
+            return state == State::Ready;
+        return finishPending();
+    }
+
+    bool GLShader::finishPending() const
+    {
+        g_pendingShaders.erase(std::remove(g_pendingShaders.begin(), g_pendingShaders.end(), this), g_pendingShaders.end());
+
+        bool compiled = checkShaderStatus(pendingVS);
+        compiled = checkShaderStatus(pendingFS) && compiled;
+
         int status = 0;
-        glGetProgramiv(programID, GL_LINK_STATUS, &status);
+        if (compiled)
+        {
+            glGetProgramiv(programID, GL_LINK_STATUS, &status);
+            if (!status)
+            {
+                char log[512];
+                glGetProgramInfoLog(programID, 512, nullptr, log);
+                std::cerr << "Program link error: " << log << std::endl;
+            }
+        }
+
+        glDeleteShader(pendingVS);
+        glDeleteShader(pendingFS);
+        pendingVS = pendingFS = 0;
+
         if (!status)
         {
-            char log[512];
-            glGetProgramInfoLog(programID, 512, nullptr, log);
-            std::cerr << "Program link error: " << log << std::endl;
             glDeleteProgram(programID);
             programID = 0;
-            glDeleteShader(vs);
-            glDeleteShader(fs);
+            state = State::Failed;
             return false;
         }
 
-        glDeleteShader(vs);
-        glDeleteShader(fs);
+        if (!pendingCachePath.empty())
+            storeProgramBinary(pendingCachePath, programID);
+        reflectUniforms();
+        state = State::Ready;
+        return true;
+    }
+
+    void PollPendingShaders()
+    {
+        ++g_shaderFrame;
+        // poll() removes finished shaders from the list, so walk a copy
+        std::vector<GLShader *> pending = g_pendingShaders;
+        for (GLShader *shader : pending)
+            shader->poll();
+    }
+
+    size_t GetPendingShaderCount()
+    {
+        return g_pendingShaders.size();
+    }
+
+    void GLShader::reflectUniforms() const
+    {
+        uniformSlots.clear();
+        slots.clear();
+
+        int count = 0, maxLength = 0;
+        glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+        for (int i = 0; i < count; ++i)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(programID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+            std::string name(nameBuffer.data(), length);
+            int location = glGetUniformLocation(programID, name.c_str());
+            if (location < 0)
+                continue; // Uniform block members have no location
+            int slot = addSlot(location);
+            uniformSlots[name] = slot;
+            // Arrays are reported as "name[0]"; make the bare name resolve too
+            size_t bracket = name.find('[');
+            if (bracket != std::string::npos)
+                uniformSlots[name.substr(0, bracket)] = slot;
+        }
+    }
+
+    int GLShader::addSlot(int location) const
+    {
+        UniformSlot slot;
+        slot.location = location;
+        slot.hasValue = false;
+        slots.push_back(slot);
+        return (int)slots.size() - 1;
+    }
+
+    GLShader::Uniform GLShader::getUniform(const std::string &name) const
+    {
+        if (state == State::Pending)
+            finishPending();
+        Uniform uniform;
+        auto it = uniformSlots.find(name);
+        if (it == uniformSlots.end())
+        {
+            // Not reflected (e.g. "array[3]", or optimized out): ask GL once and remember
+            int location = programID ? glGetUniformLocation(programID, name.c_str()) : -1;
+            int slot = location >= 0 ? addSlot(location) : -1;
+            it = uniformSlots.emplace(name, slot).first;
+        }
+        if (it->second >= 0)
+        {
+            uniform.slot = it->second;
+            uniform.location = slots[it->second].location;
+        }
+        return uniform;
+    }
+
+    void GLShader::invalidateUniformCache() const
+    {
+        for (UniformSlot &slot : slots)
+            slot.hasValue = false;
+    }
+
+    // glProgramUniform* (GL 4.1 / ARB_separate_shader_objects) targets a program directly,
+    // so the setters don't depend on which program is bound
+    static bool directUniformsSupported()
+    {
+        static const bool supported = GLEW_VERSION_4_1 || GLEW_ARB_separate_shader_objects;
+        return supported;
+    }
+
+    bool GLShader::uniformChanged(const Uniform &uniform, const void *value, size_t bytes) const
+    {
+        if (uniform.slot < 0 || uniform.slot >= (int)slots.size())
+            return false;
+        UniformSlot &slot = slots[uniform.slot];
+        if (slot.hasValue && memcmp(slot.value, value, bytes) == 0)
+            return false;
+        Batch2DOnSetUniform(programID);
+        if (!directUniformsSupported())
+        {
+            // glUniform* writes to the bound program; if that isn't this one the value
+            // never reached it, so don't remember it as sent
+            GLint current = 0;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+            if ((unsigned int)current != programID)
+            {
+                slot.hasValue = false;
+                return true;
+            }
+        }
+        memcpy(slot.value, value, bytes);
+        slot.hasValue = true;
         return true;
     }
 
@@ -110,58 +503,142 @@ namespace DotBlue
 
     void GLShader::bind() const
     {
+        // Using a pending program would block inside the driver anyway; finish it here
+        // so its uniforms are reflected before anything is set
+        if (state == State::Pending)
+            finishPending();
+        Batch2DOnBindProgram(programID);
         glUseProgram(programID);
     }
 
     void GLShader::unbind() const
     {
+        Batch2DOnBindProgram(0);
         glUseProgram(0);
     }
 
     void GLShader::setFloat(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(programID, name.c_str()), value);
+        setFloat(getUniform(name), value);
     }
 
     void GLShader::setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(programID, name.c_str()), x, y);
+        setVec2(getUniform(name), DotBlue::Vec2(x, y));
     }
 
     void GLShader::setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(programID, name.c_str()), x, y, z);
+        setVec3(getUniform(name), DotBlue::Vec3(x, y, z));
     }
 
     void GLShader::setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(programID, name.c_str()), value);
+        setInt(getUniform(name), value);
     }
 
     // GLM-friendly uniform setters
     void GLShader::setVec2(const std::string &name, const DotBlue::Vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(programID, name.c_str()), 1, &value[0]);
+        setVec2(getUniform(name), value);
     }
 
     void GLShader::setVec3(const std::string &name, const DotBlue::Vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(programID, name.c_str()), 1, &value[0]);
+        setVec3(getUniform(name), value);
     }
 
     void GLShader::setVec4(const std::string &name, const DotBlue::Vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(programID, name.c_str()), 1, &value[0]);
+        setVec4(getUniform(name), value);
     }
 
     void GLShader::setMat3(const std::string &name, const DotBlue::Mat3 &matrix) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(programID, name.c_str()), 1, GL_FALSE, &matrix[0][0]);
+        setMat3(getUniform(name), matrix);
     }
 
     void GLShader::setMat4(const std::string &name, const DotBlue::Mat4 &matrix) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(programID, name.c_str()), 1, GL_FALSE, &matrix[0][0]);
+        setMat4(getUniform(name), matrix);
+    }
+
+    // Handle-based uniform setters
+    void GLShader::setFloat(const Uniform &uniform, float value) const
+    {
+        if (uniformChanged(uniform, &value, sizeof(value)))
+        {
+            if (directUniformsSupported())
+                glProgramUniform1f(programID, uniform.location, value);
+            else
+                glUniform1f(uniform.location, value);
+        }
+    }
+
+    void GLShader::setInt(const Uniform &uniform, int value) const
+    {
+        if (uniformChanged(uniform, &value, sizeof(value)))
+        {
+            if (directUniformsSupported())
+                glProgramUniform1i(programID, uniform.location, value);
+            else
+                glUniform1i(uniform.location, value);
+        }
+    }
+
+    void GLShader::setVec2(const Uniform &uniform, const DotBlue::Vec2 &value) const
+    {
+        if (uniformChanged(uniform, &value[0], 2 * sizeof(float)))
+        {
+            if (directUniformsSupported())
+                glProgramUniform2fv(programID, uniform.location, 1, &value[0]);
+            else
+                glUniform2fv(uniform.location, 1, &value[0]);
+        }
+    }
+
+    void GLShader::setVec3(const Uniform &uniform, const DotBlue::Vec3 &value) const
+    {
+        if (uniformChanged(uniform, &value[0], 3 * sizeof(float)))
+        {
+            if (directUniformsSupported())
+                glProgramUniform3fv(programID, uniform.location, 1, &value[0]);
+            else
+                glUniform3fv(uniform.location, 1, &value[0]);
+        }
+    }
+
+    void GLShader::setVec4(const Uniform &uniform, const DotBlue::Vec4 &value) const
+    {
+        if (uniformChanged(uniform, &value[0], 4 * sizeof(float)))
+        {
+            if (directUniformsSupported())
+                glProgramUniform4fv(programID, uniform.location, 1, &value[0]);
+            else
+                glUniform4fv(uniform.location, 1, &value[0]);
+        }
+    }
+
+    void GLShader::setMat3(const Uniform &uniform, const DotBlue::Mat3 &matrix) const
+    {
+        if (uniformChanged(uniform, &matrix[0][0], 9 * sizeof(float)))
+        {
+            if (directUniformsSupported())
+                glProgramUniformMatrix3fv(programID, uniform.location, 1, GL_FALSE, &matrix[0][0]);
+            else
+                glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &matrix[0][0]);
+        }
+    }
+
+    void GLShader::setMat4(const Uniform &uniform, const DotBlue::Mat4 &matrix) const
+    {
+        if (uniformChanged(uniform, &matrix[0][0], 16 * sizeof(float)))
+        {
+            if (directUniformsSupported())
+                glProgramUniformMatrix4fv(programID, uniform.location, 1, GL_FALSE, &matrix[0][0]);
+            else
+                glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &matrix[0][0]);
+        }
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "DotBlue/DotBlue.h"
+#include "DotBlue/GLPlatform.h"
+#include "DotBlue/GLSpriteBatch.h"
+
+namespace DotBlue
+{
+    // Instances per draw call; keeps each upload well inside a GLStreamBuffer region
+    static const size_t kMaxInstancesPerDraw = 16384;
+
+    static const char *spriteVertShader = R"(
+#version 330 core
+layout(location = 0) in vec4 a_rect;     // x, y, w, h
+layout(location = 1) in vec4 a_uv;       // u0, v0, u1, v1
+layout(location = 2) in vec4 a_tint;
+layout(location = 3) in float a_rotation;
+uniform mat4 u_projection;
+out vec2 v_uv;
+out vec4 v_tint;
+void main() {
+    // Triangle strip corners: (0,0) (1,0) (0,1) (1,1)
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    vec2 local = (corner - 0.5) * a_rect.zw;
+    float c = cos(a_rotation);
+    float s = sin(a_rotation);
+    vec2 pos = a_rect.xy + 0.5 * a_rect.zw + vec2(local.x * c - local.y * s, local.x * s + local.y * c);
+    gl_Position = u_projection * vec4(pos, 0.0, 1.0);
+    v_uv = mix(a_uv.xy, a_uv.zw, corner);
+    v_tint = a_tint;
+}
+)";
+    static const char *spriteFragShader = R"(
+#version 330 core
+uniform sampler2D u_texture;
+in vec2 v_uv;
+in vec4 v_tint;
+out vec4 fragColor;
+void main() {
+    fragColor = texture(u_texture, v_uv) * v_tint;
+}
+)";
+
+    // Map a float to an unsigned key with the same ordering
+    static uint32_t orderedFloatBits(float f)
+    {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+
+    static uint8_t toUnorm8(float v)
+    {
+        return (uint8_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    SpriteBatch::SpriteBatch()
+        : shaderLoaded(false), vao(0), streamGeneration(0), width(0), height(0)
+    {
+    }
+
+    SpriteBatch::~SpriteBatch()
+    {
+        if (vao)
+            glDeleteVertexArrays(1, &vao);
+    }
+
+    bool SpriteBatch::initResources()
+    {
+        if (!shaderLoaded)
+        {
+            if (!(GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays))
+            {
+                std::cerr << "[SpriteBatch] Instanced arrays not supported, sprites will not be drawn" << std::endl;
+                return false;
+            }
+            shaderLoaded = shader.load(spriteVertShader, spriteFragShader);
+            if (!shaderLoaded)
+            {
+                std::cerr << "[SpriteBatch] Shader failed to load!" << std::endl;
+                return false;
+            }
+        }
+        if (!vao)
+        {
+            glGenVertexArrays(1, &vao);
+            glBindVertexArray(vao);
+            for (unsigned int i = 0; i < 4; ++i)
+            {
+                glEnableVertexAttribArray(i);
+                glVertexAttribDivisor(i, 1);
+            }
+        }
+        return true;
+    }
+
+    void SpriteBatch::pointInstanceAttributes(size_t offset)
+    {
+        // Expects the VAO and the stream buffer (GL_ARRAY_BUFFER) to be bound
+        const GLsizei stride = sizeof(Instance);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void *)(offset + offsetof(Instance, x)));
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void *)(offset + offsetof(Instance, u0)));
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void *)(offset + offsetof(Instance, r)));
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void *)(offset + offsetof(Instance, rotation)));
+    }
+
+    void SpriteBatch::begin(int viewportWidth, int viewportHeight)
+    {
+        if (viewportWidth <= 0 || viewportHeight <= 0)
+            GetRenderWindowSize(viewportWidth, viewportHeight);
+        width = viewportWidth;
+        height = viewportHeight;
+        instances.clear();
+        keys.clear();
+    }
+
+    void SpriteBatch::draw(unsigned int textureID, float x, float y, float w, float h,
+                           float u0, float v0, float u1, float v1,
+                           const RGBA &tint, float rotation, float depth)
+    {
+        Instance inst;
+        inst.x = x;
+        inst.y = y;
+        inst.w = w;
+        inst.h = h;
+        inst.u0 = u0;
+        inst.v0 = v0;
+        inst.u1 = u1;
+        inst.v1 = v1;
+        inst.r = toUnorm8(tint.r);
+        inst.g = toUnorm8(tint.g);
+        inst.b = toUnorm8(tint.b);
+        inst.a = toUnorm8(tint.a);
+        inst.rotation = rotation;
+
+        SortKey key;
+        key.key = ((uint64_t)orderedFloatBits(depth) << 32) | textureID;
+        key.index = (uint32_t)instances.size();
+        instances.push_back(inst);
+        keys.push_back(key);
+    }
+
+    void SpriteBatch::end()
+    {
+        stats = Stats();
+        if (instances.empty())
+            return;
+        if (!initResources())
+        {
+            instances.clear();
+            keys.clear();
+            return;
+        }
+
+        // Anything queued in the 2D batch was submitted first, so it goes underneath
+        FlushBatch2D();
+
+        // The index tie-break makes the sort stable without std::stable_sort's extra buffer
+        std::sort(keys.begin(), keys.end(), [](const SortKey &a, const SortKey &b)
+                  { return a.key != b.key ? a.key < b.key : a.index < b.index; });
+        sorted.resize(instances.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+            sorted[i] = instances[keys[i].index];
+
+        GLint previousProgram = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+        shader.bind();
+        shader.setMat4("u_projection", glm::ortho(0.0f, (float)width, (float)height, 0.0f, -1.0f, 1.0f));
+        shader.setInt("u_texture", 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(vao);
+
+        GLStreamBuffer &stream = GetStreamBuffer();
+        const bool baseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+        const size_t stride = sizeof(Instance);
+        size_t i = 0;
+        while (i < sorted.size())
+        {
+            uint32_t textureID = (uint32_t)(keys[i].key & 0xffffffffu);
+            size_t runEnd = i + 1;
+            while (runEnd < sorted.size() && runEnd - i < kMaxInstancesPerDraw &&
+                   (uint32_t)(keys[runEnd].key & 0xffffffffu) == textureID)
+                ++runEnd;
+            size_t count = runEnd - i;
+
+            size_t offset = stream.write(&sorted[i], count * stride, stride);
+            BindTexture(textureID);
+            if (baseInstance)
+            {
+                if (streamGeneration != stream.getGeneration())
+                {
+                    pointInstanceAttributes(0);
+                    streamGeneration = stream.getGeneration();
+                }
+                glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count, (GLuint)(offset / stride));
+            }
+            else
+            {
+                pointInstanceAttributes(offset);
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count);
+            }
+            ++stats.drawCalls;
+            i = runEnd;
+        }
+        stats.sprites = sorted.size();
+
+        glBindVertexArray(0);
+        glUseProgram(previousProgram);
+        instances.clear();
+        keys.clear();
+    }
+}
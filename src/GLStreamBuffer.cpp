@@ -0,0 +1,205 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <memory>
+#include <cstring>
+#include <iostream>
+#include "DotBlue/DotBlue.h"
+#include "DotBlue/GLPlatform.h"
+#include "DotBlue/GLStreamBuffer.h"
+
+namespace DotBlue
+{
+    static std::unique_ptr<GLStreamBuffer> g_streamBuffer = nullptr;
+
+    static size_t alignUp(size_t value, size_t alignment)
+    {
+        if (alignment <= 1)
+            return value;
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    GLStreamBuffer::GLStreamBuffer(size_t size)
+        : buffer(0), generation(0), regionSize(0), persistent(false), mapped(nullptr), region(0), cursor(0)
+    {
+        for (int i = 0; i < kRegionCount; ++i)
+            fences[i] = nullptr;
+        create(size);
+    }
+
+    GLStreamBuffer::~GLStreamBuffer()
+    {
+        destroy();
+    }
+
+    void GLStreamBuffer::create(size_t newRegionSize)
+    {
+        regionSize = newRegionSize;
+        region = 0;
+        cursor = 0;
+        persistent = (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) && (GLEW_VERSION_3_2 || GLEW_ARB_sync);
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        GLsizeiptr capacity = (GLsizeiptr)(regionSize * kRegionCount);
+        if (persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, capacity, nullptr, flags);
+            mapped = (unsigned char *)glMapBufferRange(GL_ARRAY_BUFFER, 0, capacity, flags);
+            if (!mapped)
+            {
+                std::cerr << "[GLStreamBuffer] Persistent mapping failed, falling back to orphaning" << std::endl;
+                glDeleteBuffers(1, &buffer);
+                glGenBuffers(1, &buffer);
+                glBindBuffer(GL_ARRAY_BUFFER, buffer);
+                persistent = false;
+            }
+        }
+        if (!persistent)
+            glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        ++generation;
+    }
+
+    void GLStreamBuffer::destroy()
+    {
+        for (int i = 0; i < kRegionCount; ++i)
+        {
+            if (fences[i])
+            {
+                glDeleteSync((GLsync)fences[i]);
+                fences[i] = nullptr;
+            }
+        }
+        if (buffer)
+        {
+            if (mapped)
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, buffer);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+                mapped = nullptr;
+            }
+            glDeleteBuffers(1, &buffer);
+            buffer = 0;
+        }
+    }
+
+    size_t GLStreamBuffer::regionEnd() const
+    {
+        return persistent ? (size_t)(region + 1) * regionSize : regionSize * kRegionCount;
+    }
+
+    void GLStreamBuffer::waitRegion(int index)
+    {
+        GLsync fence = (GLsync)fences[index];
+        if (!fence)
+            return;
+        // Flush on the first wait so the fence is guaranteed to signal
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (true)
+        {
+            GLenum result = glClientWaitSync(fence, flags, 1000000000ull);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+                break;
+            flags = 0;
+        }
+        glDeleteSync(fence);
+        fences[index] = nullptr;
+    }
+
+    void GLStreamBuffer::advanceRegion()
+    {
+        if (fences[region])
+            glDeleteSync((GLsync)fences[region]);
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region = (region + 1) % kRegionCount;
+        waitRegion(region);
+        cursor = (size_t)region * regionSize;
+    }
+
+    void GLStreamBuffer::reserve(size_t bytes)
+    {
+        if (bytes > regionSize)
+        {
+            // Too big for one region: wait for the GPU and recreate a larger buffer
+            for (int i = 0; i < kRegionCount; ++i)
+                waitRegion(i);
+            destroy();
+            size_t newSize = regionSize;
+            while (newSize < bytes)
+                newSize *= 2;
+            std::cout << "[GLStreamBuffer] Growing region size to " << newSize << " bytes" << std::endl;
+            create(newSize);
+            return;
+        }
+        if (cursor + bytes <= regionEnd())
+            return;
+        if (persistent)
+        {
+            advanceRegion();
+        }
+        else
+        {
+            // Orphan: the driver keeps the old storage alive for draws still in flight
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(regionSize * kRegionCount), nullptr, GL_STREAM_DRAW);
+            cursor = 0;
+        }
+    }
+
+    size_t GLStreamBuffer::write(const void *data, size_t bytes, size_t alignment)
+    {
+        size_t offset = alignUp(cursor, alignment);
+        if (offset + bytes > regionEnd())
+        {
+            reserve(bytes + alignment);
+            offset = alignUp(cursor, alignment);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        if (persistent)
+        {
+            memcpy(mapped + offset, data, bytes);
+        }
+        else
+        {
+            void *ptr = glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)offset, (GLsizeiptr)bytes,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (ptr)
+            {
+                memcpy(ptr, data, bytes);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+            }
+            else
+            {
+                glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)offset, (GLsizeiptr)bytes, data);
+            }
+        }
+        cursor = offset + bytes;
+        return offset;
+    }
+
+    void GLStreamBuffer::endFrame()
+    {
+        if (persistent && cursor != (size_t)region * regionSize)
+            advanceRegion();
+    }
+
+    GLStreamBuffer &GetStreamBuffer()
+    {
+        if (!g_streamBuffer)
+            g_streamBuffer = std::make_unique<GLStreamBuffer>();
+        return *g_streamBuffer;
+    }
+
+    void StreamBufferEndFrame()
+    {
+        if (g_streamBuffer)
+            g_streamBuffer->endFrame();
+    }
+
+    void ShutdownStreamBuffer()
+    {
+        g_streamBuffer.reset();
+    }
+}
@@ -0,0 +1,276 @@
+#include <vector>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include "DotBlue/DotBlue.h"
+#include "DotBlue/GLPlatform.h"
+#include "DotBlue/GLGlyphCache.h"
+#include "DotBlue/GLTextLayout.h"
+
+namespace DotBlue
+{
+    // Cached layouts kept before the least recently used half is dropped
+    static const size_t kMaxCachedLayouts = 2048;
+
+    TextLayout::TextLayout()
+        : size(0.0f), width(0.0f), height(0.0f), top(0.0f), lineHeight(0.0f), maxGlyphHeight(0.0f),
+          quadGeneration(0), quadsValid(false)
+    {
+    }
+
+    void TextLayout::build(const GLFont &fontIn, const std::string &text, float maxWidth, float sizeIn)
+    {
+        font = fontIn.glyphs;
+        size = sizeIn;
+        width = height = top = lineHeight = maxGlyphHeight = 0.0f;
+        glyphs.clear();
+        lines.clear();
+        quadsValid = false;
+        if (!fontIn.glyphs)
+            return;
+
+        GLGlyphCache &cache = *fontIn.glyphs;
+        const float k = size > 0.0f ? size / cache.getPixelHeight() : 1.0f;
+        lineHeight = (cache.getAscent() - cache.getDescent() + cache.getLineGap()) * k;
+        top = -cache.getAscent() * k;
+
+        size_t lineStart = 0;
+        size_t breakAfter = SIZE_MAX; // Index of the last space on the current line
+        float penX = 0.0f;
+
+        auto finishLine = [&](size_t end)
+        {
+            Line line;
+            line.firstGlyph = lineStart;
+            line.glyphCount = end - lineStart;
+            line.baseline = lines.size() * lineHeight;
+            line.width = 0.0f;
+            // Trailing spaces do not count towards the width
+            for (size_t i = end; i > lineStart; --i)
+            {
+                if (glyphs[i - 1].codepoint != ' ')
+                {
+                    const GLGlyphCache::Glyph *last = cache.getGlyph(glyphs[i - 1].codepoint);
+                    line.width = glyphs[i - 1].x + last->advance * k;
+                    break;
+                }
+            }
+            width = std::max(width, line.width);
+            lines.push_back(line);
+            lineStart = end;
+            breakAfter = SIZE_MAX;
+        };
+
+        const char *s = text.c_str();
+        while (*s)
+        {
+            uint32_t codepoint = DecodeUTF8(s);
+            if (codepoint == '\n')
+            {
+                finishLine(glyphs.size());
+                penX = 0.0f;
+                continue;
+            }
+            if (codepoint < 32)
+                continue;
+
+            const GLGlyphCache::Glyph *glyph = cache.getGlyph(codepoint);
+            float advance = glyph->advance * k;
+            if (maxWidth > 0.0f && codepoint != ' ' && penX + advance > maxWidth && glyphs.size() > lineStart)
+            {
+                if (breakAfter != SIZE_MAX)
+                {
+                    // Move the word after the last space down to the next line
+                    size_t wordStart = breakAfter + 1;
+                    finishLine(wordStart);
+                    float shift = wordStart < glyphs.size() ? glyphs[wordStart].x : penX;
+                    for (size_t i = wordStart; i < glyphs.size(); ++i)
+                    {
+                        glyphs[i].x -= shift;
+                        glyphs[i].line = (uint32_t)lines.size();
+                    }
+                    penX -= shift;
+                }
+                else
+                {
+                    // One word wider than the line: break it here
+                    finishLine(glyphs.size());
+                    penX = 0.0f;
+                }
+            }
+
+            if (codepoint == ' ')
+                breakAfter = glyphs.size();
+            glyphs.push_back({codepoint, penX, (uint32_t)lines.size()});
+            maxGlyphHeight = std::max(maxGlyphHeight, glyph->height * k);
+            penX += advance;
+        }
+        finishLine(glyphs.size());
+        height = lines.size() * lineHeight;
+    }
+
+    void TextLayout::refreshQuads(GLGlyphCache &cache) const
+    {
+        // Resolve every glyph before building quads: rasterizing one may move others
+        cache.beginUse();
+        for (const PlacedGlyph &g : glyphs)
+            cache.getGlyph(g.codepoint);
+        cache.upload();
+
+        quads.clear();
+        textures.clear();
+        pages.clear();
+        for (const PlacedGlyph &g : glyphs)
+        {
+            const GLGlyphCache::Glyph *glyph = cache.getGlyph(g.codepoint);
+            if (glyph->page < 0)
+                continue;
+            quads.push_back(cache.makeQuad(*glyph, g.x, lines[g.line].baseline, size));
+            textures.push_back(cache.getPageTexture(glyph->page));
+            if (std::find(pages.begin(), pages.end(), glyph->page) == pages.end())
+                pages.push_back(glyph->page);
+        }
+        quadGeneration = cache.getGeneration();
+        quadsValid = true;
+    }
+
+    bool TextLayout::getQuads(float x, float y, std::vector<stbtt_aligned_quad> &outQuads,
+                              std::vector<unsigned int> &outTextures) const
+    {
+        std::shared_ptr<GLGlyphCache> cache = font.lock();
+        if (!cache)
+            return false;
+
+        if (!quadsValid || quadGeneration != cache->getGeneration())
+        {
+            refreshQuads(*cache);
+        }
+        else
+        {
+            // Keep the pages this layout samples from looking recently used
+            cache->beginUse();
+            for (int page : pages)
+                cache->touchPage(page);
+        }
+
+        // Unscaled bitmap glyphs were snapped to whole pixels; keep them there
+        if (!cache->isSDF() && size <= 0.0f)
+        {
+            x = std::floor(x + 0.5f);
+            y = std::floor(y + 0.5f);
+        }
+        for (size_t i = 0; i < quads.size(); ++i)
+        {
+            stbtt_aligned_quad q = quads[i];
+            q.x0 += x;
+            q.x1 += x;
+            q.y0 += y;
+            q.y1 += y;
+            outQuads.push_back(q);
+            outTextures.push_back(textures[i]);
+        }
+        return true;
+    }
+
+    struct LayoutKey
+    {
+        const GLGlyphCache *font;
+        std::string text;
+        float maxWidth;
+        float size;
+
+        bool operator==(const LayoutKey &other) const
+        {
+            return font == other.font && maxWidth == other.maxWidth && size == other.size && text == other.text;
+        }
+    };
+
+    struct LayoutKeyHash
+    {
+        size_t operator()(const LayoutKey &key) const
+        {
+            size_t h = std::hash<std::string>()(key.text);
+            h ^= std::hash<const void *>()(key.font) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            h ^= std::hash<float>()(key.maxWidth) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            h ^= std::hash<float>()(key.size) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    struct LayoutEntry
+    {
+        std::shared_ptr<const TextLayout> layout;
+        uint64_t lastUsed;
+    };
+
+    static std::unordered_map<LayoutKey, LayoutEntry, LayoutKeyHash> g_layoutCache;
+    static uint64_t g_layoutClock = 0;
+
+    static void trimLayoutCache()
+    {
+        // Drop the least recently used half
+        std::vector<uint64_t> ages;
+        ages.reserve(g_layoutCache.size());
+        for (const auto &entry : g_layoutCache)
+            ages.push_back(entry.second.lastUsed);
+        auto middle = ages.begin() + ages.size() / 2;
+        std::nth_element(ages.begin(), middle, ages.end());
+        uint64_t cutoff = *middle;
+        for (auto it = g_layoutCache.begin(); it != g_layoutCache.end();)
+        {
+            if (it->second.lastUsed < cutoff)
+                it = g_layoutCache.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    static std::shared_ptr<const TextLayout> buildLayout(const GLFont &font, const std::string &text, float maxWidth,
+                                                         float size)
+    {
+        auto layout = std::make_shared<TextLayout>();
+        layout->build(font, text, maxWidth, size);
+        return layout;
+    }
+
+    std::shared_ptr<const TextLayout> GetTextLayout(const GLFont &font, const std::string &text, float maxWidth,
+                                                    float size)
+    {
+        if (!font.glyphs)
+            return std::make_shared<TextLayout>();
+
+        LayoutKey key{font.glyphs.get(), text, maxWidth, size};
+        auto it = g_layoutCache.find(key);
+        if (it != g_layoutCache.end())
+        {
+            // A font freed and reallocated at the same address must not reuse old layouts.
+            // Replace rather than rebuild, callers may still hold the old one.
+            if (it->second.layout->getFont() != font.glyphs)
+                it->second.layout = buildLayout(font, text, maxWidth, size);
+            it->second.lastUsed = ++g_layoutClock;
+            return it->second.layout;
+        }
+
+        if (g_layoutCache.size() >= kMaxCachedLayouts)
+            trimLayoutCache();
+        LayoutEntry entry;
+        entry.layout = buildLayout(font, text, maxWidth, size);
+        entry.lastUsed = ++g_layoutClock;
+        std::shared_ptr<const TextLayout> layout = entry.layout;
+        g_layoutCache.emplace(std::move(key), std::move(entry));
+        return layout;
+    }
+
+    void ClearTextLayoutCache()
+    {
+        g_layoutCache.clear();
+    }
+
+    void ShutdownTextLayoutCache()
+    {
+        g_layoutCache.clear();
+    }
+}
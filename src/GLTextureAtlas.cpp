@@ -1,5 +1,7 @@
 #include "DotBlue/DotBlue.h"
 #include "DotBlue/GLPlatform.h"
+#include "DotBlue/GLTextureCache.h"
+#include "DotBlue/GLTextureRegistry.h"
 #ifdef _WIN32
 
 #include <windows.h>
@@ -10,6 +12,7 @@
 #undef UNICODE
 #undef _UNICODE
 #elif defined(__linux__) || defined(__FreeBSD__)
+#include <GL/glew.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <GL/glx.h>
@@ -26,13 +29,22 @@
 #include <cstdio>
 #include <utility>
 #include <string>
+#include <memory>
+#include <thread>
+#include <future>
+#include <algorithm>
+#include <cstring>
 #include "DotBlue/stb_image.h"
 
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
 namespace DotBlue
 {
 
-    GLTextureAtlas::GLTextureAtlas(const std::string &pngPath, int imgW, int imgH)
-        : textureID(0), imgWidth(imgW), imgHeight(imgH), selectedIndex(0)
+    GLTextureAtlas::GLTextureAtlas(const std::string &pngPath, int imgW, int imgH, bool arrayTexture)
+        : textureID(0), arrayTextureID(0), imgWidth(imgW), imgHeight(imgH), selectedIndex(0)
     {
         // Load PNG and get atlas size
         textureID = LoadPNGTexture(pngPath);
@@ -44,18 +56,88 @@ namespace DotBlue
         rows = atlasHeight / imgHeight;
         printf("[GLTextureAtlas] atlasWidth=%d atlasHeight=%d imgWidth=%d imgHeight=%d cols=%d rows=%d\n",
             atlasWidth, atlasHeight, imgWidth, imgHeight, cols, rows);
+        if (arrayTexture)
+            createArrayTexture();
         select(0); // Default to first image
     }
 
+    void GLTextureAtlas::createArrayTexture()
+    {
+        if (!(GLEW_VERSION_3_0 || GLEW_EXT_texture_array))
+        {
+            std::cerr << "[GLTextureAtlas] Array textures not supported, using the 2D atlas" << std::endl;
+            return;
+        }
+        const int layers = rows * cols;
+        if (!textureID || layers <= 0)
+            return;
+
+        // Read the atlas back (the 2D texture may have come from a compressed cache entry)
+        // and copy each tile into its own layer straight from the full image
+        std::vector<unsigned char> pixels((size_t)atlasWidth * atlasHeight * 4);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+        int levels = 1;
+        while ((imgWidth >> levels) > 0 || (imgHeight >> levels) > 0)
+            ++levels;
+
+        glGenTextures(1, &arrayTextureID);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, arrayTextureID);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, imgWidth, imgHeight, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     nullptr);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, atlasWidth);
+        for (int layer = 0; layer < layers; ++layer)
+        {
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, (layer % cols) * imgWidth);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, (layer / cols) * imgHeight);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, imgWidth, imgHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                            pixels.data());
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // Layers are filtered independently, so every level stays free of neighbour bleed
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        RegisterTexture(arrayTextureID, "atlas array", nullptr, true);
+    }
+
+    GLTextureAtlas::GLTextureAtlas()
+        : textureID(0), arrayTextureID(0), atlasWidth(0), atlasHeight(0), imgWidth(0), imgHeight(0), rows(0), cols(0),
+          selectedIndex(0), u0(0.0f), v0(0.0f), u1(0.0f), v1(0.0f)
+    {
+    }
+
     GLTextureAtlas::~GLTextureAtlas()
     {
-        if (textureID)
-            glDeleteTextures(1, &textureID);
+        DeleteTexture(textureID);
+        DeleteTexture(arrayTextureID);
     }
 
     void GLTextureAtlas::select(int index)
     {
     selectedIndex = index;
+    if (!regions.empty())
+    {
+        if (index < 0 || index >= (int)regions.size())
+            return;
+        const Region &region = regions[index];
+        u0 = region.u0;
+        v0 = region.v0;
+        u1 = region.u1;
+        v1 = region.v1;
+        return;
+    }
     int col = index % cols;
     int row = index / cols;
     u0 = (float)(col * imgWidth) / atlasWidth;
@@ -64,9 +146,32 @@ namespace DotBlue
     v1 = (float)((row + 1) * imgHeight) / atlasHeight;
     }
 
+    bool GLTextureAtlas::select(const std::string &name)
+    {
+        auto it = regionIndex.find(name);
+        if (it == regionIndex.end())
+            return false;
+        select((int)it->second);
+        return true;
+    }
+
+    const GLTextureAtlas::Region *GLTextureAtlas::findRegion(const std::string &name) const
+    {
+        auto it = regionIndex.find(name);
+        return it != regionIndex.end() ? &regions[it->second] : nullptr;
+    }
+
     void GLTextureAtlas::bind() const
     {
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        if (arrayTextureID)
+        {
+            TouchTexture(arrayTextureID);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, arrayTextureID);
+        }
+        else
+        {
+            BindTexture(textureID);
+        }
     }
 
     void GLTextureAtlas::draw_quad(float x, float y, float w, float h) const
@@ -75,4 +180,311 @@ namespace DotBlue
         TexturedQuadShaderUV(textureID, x, y, x + w, y + h, u0, v0, u1, v1);
     }
 
-}
\ No newline at end of file
+    void GLTextureAtlas::draw_sprite(SpriteBatch &batch, float x, float y, float w, float h,
+                                     const RGBA &tint, float rotation, float depth) const
+    {
+        batch.draw(textureID, x, y, w, h, u0, v0, u1, v1, tint, rotation, depth);
+    }
+
+    GLTextureAtlas::Builder &GLTextureAtlas::Builder::setPadding(int pixels)
+    {
+        padding = std::max(0, pixels);
+        return *this;
+    }
+
+    GLTextureAtlas::Builder &GLTextureAtlas::Builder::setExtrude(int pixels)
+    {
+        extrude = std::max(0, pixels);
+        return *this;
+    }
+
+    GLTextureAtlas::Builder &GLTextureAtlas::Builder::setMaxSize(int pixels)
+    {
+        maxSize = pixels;
+        return *this;
+    }
+
+    GLTextureAtlas::Builder &GLTextureAtlas::Builder::add(const std::string &name, const std::string &pngPath)
+    {
+        Entry entry;
+        entry.name = name;
+        entry.path = pngPath;
+        entries.push_back(std::move(entry));
+        return *this;
+    }
+
+    GLTextureAtlas::Builder &GLTextureAtlas::Builder::add(const std::string &name, const unsigned char *rgba,
+                                                          int width, int height)
+    {
+        Entry entry;
+        entry.name = name;
+        entry.pixels.assign(rgba, rgba + (size_t)width * height * 4);
+        entry.width = width;
+        entry.height = height;
+        entries.push_back(std::move(entry));
+        return *this;
+    }
+
+    // Run fn(i) for i in [0, count) spread over the available cores
+    template <typename Fn>
+    static void parallelFor(size_t count, Fn fn)
+    {
+        size_t threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min(threads, count);
+        if (threads <= 1)
+        {
+            for (size_t i = 0; i < count; ++i)
+                fn(i);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]
+            {
+                for (size_t i = t; i < count; i += threads)
+                    fn(i);
+            });
+        }
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    // Pack rects into width x height; true if all of them fit
+    static bool packRects(std::vector<stbrp_rect> &rects, int width, int height)
+    {
+        std::vector<stbrp_node> nodes(width);
+        stbrp_context context;
+        stbrp_init_target(&context, width, height, nodes.data(), (int)nodes.size());
+        return stbrp_pack_rects(&context, rects.data(), (int)rects.size()) != 0;
+    }
+
+    // Packed atlases are evictable once they have a container to re-stream from
+    static void registerPackedTexture(unsigned int textureID, const std::string &cachePath)
+    {
+        RegisterTexture(textureID, "packed atlas", [cachePath](unsigned int id)
+        {
+            return LoadTextureContainer(cachePath, nullptr, nullptr, nullptr, id) != 0;
+        });
+    }
+
+    std::unique_ptr<GLTextureAtlas> GLTextureAtlas::Builder::build() const
+    {
+        // Work on a name-sorted copy; a later add() with the same name replaces the earlier
+        std::vector<Entry> images;
+        images.reserve(entries.size());
+        for (size_t i = entries.size(); i-- > 0;)
+        {
+            bool seen = false;
+            for (const Entry &image : images)
+                seen = seen || image.name == entries[i].name;
+            if (!seen)
+                images.push_back(entries[i]);
+        }
+        std::sort(images.begin(), images.end(), [](const Entry &a, const Entry &b) { return a.name < b.name; });
+
+        // The packed result only depends on the inputs and settings, so a container
+        // converted on an earlier run skips decoding and packing entirely
+        uint64_t key = 14695981039346656037ull;
+        const int settings[3] = {padding, extrude, maxSize};
+        key = HashTextureData(key, settings, sizeof(settings));
+        for (const Entry &image : images)
+        {
+            key = HashTextureData(key, image.name.c_str(), image.name.size() + 1);
+            if (!image.path.empty())
+            {
+                key = HashTextureSource(key, image.path);
+                continue;
+            }
+            const int size[2] = {image.width, image.height};
+            key = HashTextureData(key, size, sizeof(size));
+            key = HashTextureData(key, image.pixels.data(), image.pixels.size());
+        }
+        const std::string cachePath = TextureCachePath(key);
+        if (!cachePath.empty())
+        {
+            std::unique_ptr<GLTextureAtlas> atlas(new GLTextureAtlas());
+            atlas->textureID = LoadTextureContainer(cachePath, &atlas->atlasWidth, &atlas->atlasHeight, &atlas->regions);
+            if (atlas->textureID && !atlas->regions.empty())
+            {
+                atlas->rows = 1;
+                atlas->cols = (int)atlas->regions.size();
+                for (size_t i = 0; i < atlas->regions.size(); ++i)
+                    atlas->regionIndex[atlas->regions[i].name] = i;
+                registerPackedTexture(atlas->textureID, cachePath);
+                atlas->select(0);
+                return atlas;
+            }
+        }
+
+        parallelFor(images.size(), [&](size_t i)
+        {
+            Entry &image = images[i];
+            if (image.path.empty())
+                return;
+            int channels = 0;
+            unsigned char *data = stbi_load(image.path.c_str(), &image.width, &image.height, &channels, 4);
+            if (!data)
+            {
+                image.width = image.height = 0;
+                return;
+            }
+            image.pixels.assign(data, data + (size_t)image.width * image.height * 4);
+            stbi_image_free(data);
+        });
+
+        for (size_t i = 0; i < images.size();)
+        {
+            if (images[i].pixels.empty())
+            {
+                std::cerr << "[GLTextureAtlas] Failed to load image: " << images[i].name << std::endl;
+                images.erase(images.begin() + i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        if (images.empty())
+            return nullptr;
+
+        const int border = extrude + padding;
+        std::vector<stbrp_rect> rects(images.size());
+        size_t area = 0;
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            rects[i].id = (int)i;
+            rects[i].w = images[i].width + border * 2;
+            rects[i].h = images[i].height + border * 2;
+            area += (size_t)rects[i].w * rects[i].h;
+        }
+
+        // Candidate sizes smallest first (power-of-two squares and 2:1 strips), packed in parallel
+        std::vector<std::pair<int, int>> sizes;
+        for (int size = 64; size <= maxSize; size *= 2)
+        {
+            if ((size_t)size * size / 2 >= area && size / 2 >= 64)
+                sizes.push_back({size, size / 2});
+            if ((size_t)size * size >= area)
+                sizes.push_back({size, size});
+        }
+        std::vector<std::future<std::vector<stbrp_rect>>> attempts;
+        for (const auto &size : sizes)
+        {
+            attempts.push_back(std::async(std::launch::async, [&rects, size]
+            {
+                std::vector<stbrp_rect> attempt = rects;
+                if (!packRects(attempt, size.first, size.second))
+                    attempt.clear();
+                return attempt;
+            }));
+        }
+        int width = 0, height = 0;
+        for (size_t i = 0; i < attempts.size(); ++i)
+        {
+            std::vector<stbrp_rect> attempt = attempts[i].get();
+            if (width == 0 && !attempt.empty())
+            {
+                rects = std::move(attempt);
+                width = sizes[i].first;
+                height = sizes[i].second;
+            }
+        }
+        if (width == 0)
+        {
+            std::cerr << "[GLTextureAtlas] " << images.size() << " images do not fit in " << maxSize << "x"
+                      << maxSize << std::endl;
+            return nullptr;
+        }
+
+        // stb_rect_pack sorts with qsort, so equal-sized rects can land in any order; hand
+        // their slots out by name so the layout is the same on every platform
+        std::sort(rects.begin(), rects.end(), [](const stbrp_rect &a, const stbrp_rect &b)
+        {
+            if (a.w != b.w)
+                return a.w < b.w;
+            if (a.h != b.h)
+                return a.h < b.h;
+            return a.y != b.y ? a.y < b.y : a.x < b.x;
+        });
+        for (size_t first = 0; first < rects.size();)
+        {
+            size_t last = first + 1;
+            while (last < rects.size() && rects[last].w == rects[first].w && rects[last].h == rects[first].h)
+                ++last;
+            std::vector<int> ids;
+            for (size_t i = first; i < last; ++i)
+                ids.push_back(rects[i].id);
+            std::sort(ids.begin(), ids.end()); // Images are name-sorted, so id order is name order
+            for (size_t i = first; i < last; ++i)
+                rects[i].id = ids[i - first];
+            first = last;
+        }
+        std::sort(rects.begin(), rects.end(), [](const stbrp_rect &a, const stbrp_rect &b) { return a.id < b.id; });
+
+        std::vector<unsigned char> pixels((size_t)width * height * 4, 0);
+        parallelFor(images.size(), [&](size_t i)
+        {
+            // Copy the image and extend its edge pixels outwards by `extrude`
+            const Entry &image = images[i];
+            const int x0 = rects[i].x + padding;
+            const int y0 = rects[i].y + padding;
+            const int h = image.height + extrude * 2;
+            for (int y = 0; y < h; ++y)
+            {
+                int sy = std::min(std::max(y - extrude, 0), image.height - 1);
+                unsigned char *dst = &pixels[((size_t)(y0 + y) * width + x0) * 4];
+                const unsigned char *src = &image.pixels[(size_t)sy * image.width * 4];
+                for (int x = 0; x < extrude; ++x)
+                    memcpy(dst + x * 4, src, 4);
+                memcpy(dst + extrude * 4, src, (size_t)image.width * 4);
+                for (int x = 0; x < extrude; ++x)
+                    memcpy(dst + (extrude + image.width + x) * 4, src + (image.width - 1) * 4, 4);
+            }
+        });
+
+        std::unique_ptr<GLTextureAtlas> atlas(new GLTextureAtlas());
+        atlas->atlasWidth = width;
+        atlas->atlasHeight = height;
+        atlas->rows = 1;
+        atlas->cols = (int)images.size();
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            Region region;
+            region.name = images[i].name;
+            region.x = rects[i].x + border;
+            region.y = rects[i].y + border;
+            region.width = images[i].width;
+            region.height = images[i].height;
+            region.u0 = (float)region.x / width;
+            region.v0 = (float)region.y / height;
+            region.u1 = (float)(region.x + region.width) / width;
+            region.v1 = (float)(region.y + region.height) / height;
+            atlas->regionIndex[region.name] = i;
+            atlas->regions.push_back(std::move(region));
+        }
+
+        atlas->textureID = StoreTextureCacheEntry(cachePath, pixels.data(), width, height, &atlas->regions);
+        if (atlas->textureID)
+        {
+            registerPackedTexture(atlas->textureID, cachePath);
+        }
+        else
+        {
+            glGenTextures(1, &atlas->textureID);
+            glBindTexture(GL_TEXTURE_2D, atlas->textureID);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            // No container to re-stream from, so it stays resident
+            RegisterTexture(atlas->textureID, "packed atlas");
+        }
+
+        std::cout << "[GLTextureAtlas] Packed " << images.size() << " images into " << width << "x" << height
+                  << std::endl;
+        atlas->select(0);
+        return atlas;
+    }
+}
@@ -0,0 +1,614 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <vector>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include "DotBlue/DotBlue.h"
+#include "DotBlue/GLPlatform.h"
+#include "DotBlue/GLTextureCache.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace DotBlue
+{
+    static std::string g_textureCacheDir;
+    static bool g_textureCacheDirSet = false;
+    static TextureCacheOptions g_textureCacheOptions;
+    static TextureCacheStats g_textureCacheStats;
+
+    static const uint32_t kTextureCacheMagic = 0x58544244; // "DBTX"
+    static const uint32_t kTextureCacheVersion = 1;
+
+    enum ContainerFormat : uint32_t
+    {
+        FORMAT_RGBA8 = 0,
+        FORMAT_BC1 = 1,
+        FORMAT_BC3 = 2
+    };
+
+    // File layout: ContainerHeader, mipCount MipEntry, regionCount RegionEntry, region
+    // names, then the level data (each level 16-byte aligned). All little-endian.
+    struct ContainerHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;
+        uint32_t regionCount;
+        uint32_t reserved;
+    };
+
+    struct MipEntry
+    {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct RegionEntry
+    {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        int32_t x, y, width, height;
+        float u0, v0, u1, v1;
+    };
+
+    void SetTextureCacheDirectory(const std::string &dir)
+    {
+        g_textureCacheDir = dir;
+        g_textureCacheDirSet = true;
+    }
+
+    const std::string &GetTextureCacheDirectory()
+    {
+        if (!g_textureCacheDirSet)
+        {
+            std::error_code ec;
+            std::filesystem::path tmp = std::filesystem::temp_directory_path(ec);
+            g_textureCacheDir = ec ? std::string() : (tmp / "dotblue_texcache").string();
+            g_textureCacheDirSet = true;
+        }
+        return g_textureCacheDir;
+    }
+
+    void SetTextureCacheOptions(const TextureCacheOptions &options)
+    {
+        g_textureCacheOptions = options;
+    }
+
+    const TextureCacheOptions &GetTextureCacheOptions()
+    {
+        return g_textureCacheOptions;
+    }
+
+    TextureCacheStats GetTextureCacheStats()
+    {
+        return g_textureCacheStats;
+    }
+
+    uint64_t HashTextureData(uint64_t hash, const void *data, size_t length)
+    {
+        const unsigned char *bytes = (const unsigned char *)data;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t HashTextureSource(uint64_t hash, const std::string &path)
+    {
+        std::error_code ec;
+        std::filesystem::path absolute = std::filesystem::absolute(path, ec);
+        std::string name = ec ? path : absolute.string();
+        hash = HashTextureData(hash, name.c_str(), name.size() + 1);
+        uint64_t size = (uint64_t)std::filesystem::file_size(path, ec);
+        if (ec)
+            size = 0;
+        hash = HashTextureData(hash, &size, sizeof(size));
+        int64_t mtime = 0;
+        auto written = std::filesystem::last_write_time(path, ec);
+        if (!ec)
+            mtime = (int64_t)written.time_since_epoch().count();
+        return HashTextureData(hash, &mtime, sizeof(mtime));
+    }
+
+    std::string TextureCachePath(uint64_t key)
+    {
+        const std::string &dir = GetTextureCacheDirectory();
+        if (dir.empty())
+            return std::string();
+        // Containers written with other options are different entries
+        const uint32_t options[3] = {kTextureCacheVersion, (uint32_t)g_textureCacheOptions.compression,
+                                     (uint32_t)g_textureCacheOptions.mipmaps};
+        key = HashTextureData(key, options, sizeof(options));
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.dbtex", (unsigned long long)key);
+        return (std::filesystem::path(dir) / name).string();
+    }
+
+    // Read-only view of a whole file
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string &path) : data(nullptr), size(0)
+        {
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL, nullptr);
+            mapping = nullptr;
+            if (file == INVALID_HANDLE_VALUE)
+                return;
+            LARGE_INTEGER length;
+            if (!GetFileSizeEx(file, &length) || length.QuadPart == 0)
+                return;
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping)
+                return;
+            data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (data)
+                size = (size_t)length.QuadPart;
+#else
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return;
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                void *view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (view != MAP_FAILED)
+                {
+                    data = (const unsigned char *)view;
+                    size = (size_t)st.st_size;
+                }
+            }
+            // The mapping stays valid after the descriptor is closed
+            close(fd);
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef _WIN32
+            if (data)
+                UnmapViewOfFile(data);
+            if (mapping)
+                CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+#else
+            if (data)
+                munmap((void *)data, size);
+#endif
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const unsigned char *data;
+        size_t size;
+
+    private:
+#ifdef _WIN32
+        HANDLE file;
+        HANDLE mapping;
+#endif
+    };
+
+    // Half-size RGBA8 level with a 2x2 box filter (edge texels repeat on odd sizes)
+    static std::vector<unsigned char> downsample(const unsigned char *src, int width, int height, int &outW, int &outH)
+    {
+        outW = std::max(1, width / 2);
+        outH = std::max(1, height / 2);
+        std::vector<unsigned char> dst((size_t)outW * outH * 4);
+        for (int y = 0; y < outH; ++y)
+        {
+            int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+            for (int x = 0; x < outW; ++x)
+            {
+                int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                for (int c = 0; c < 4; ++c)
+                {
+                    int sum = src[((size_t)y0 * width + x0) * 4 + c] + src[((size_t)y0 * width + x1) * 4 + c] +
+                              src[((size_t)y1 * width + x0) * 4 + c] + src[((size_t)y1 * width + x1) * 4 + c];
+                    dst[((size_t)y * outW + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        return dst;
+    }
+
+    static uint16_t packRGB565(int r, int g, int b)
+    {
+        return (uint16_t)(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+    }
+
+    static void unpackRGB565(uint16_t c, int rgb[3])
+    {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // Four-colour BC1 block for 16 RGBA texels: endpoints from the inset bounding box,
+    // each texel takes the nearest of the four palette entries
+    static void encodeColorBlock(const unsigned char *texels, unsigned char *out)
+    {
+        int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                lo[c] = std::min(lo[c], (int)texels[i * 4 + c]);
+                hi[c] = std::max(hi[c], (int)texels[i * 4 + c]);
+            }
+        }
+        for (int c = 0; c < 3; ++c)
+        {
+            // Pull the endpoints in by 1/16 of the range; the extremes are rarely worth exact
+            int inset = (hi[c] - lo[c]) >> 4;
+            lo[c] = std::min(255, lo[c] + inset);
+            hi[c] = std::max(0, hi[c] - inset);
+        }
+
+        uint16_t c0 = packRGB565(hi[0], hi[1], hi[2]);
+        uint16_t c1 = packRGB565(lo[0], lo[1], lo[2]);
+        uint32_t indices = 0;
+        if (c0 != c1)
+        {
+            if (c0 < c1)
+                std::swap(c0, c1);
+            int palette[4][3];
+            unpackRGB565(c0, palette[0]);
+            unpackRGB565(c1, palette[1]);
+            for (int c = 0; c < 3; ++c)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            for (int i = 0; i < 16; ++i)
+            {
+                int best = 0, bestError = 0x7fffffff;
+                for (int p = 0; p < 4; ++p)
+                {
+                    int error = 0;
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        int d = texels[i * 4 + c] - palette[p][c];
+                        error += d * d;
+                    }
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= (uint32_t)best << (i * 2);
+            }
+        }
+        out[0] = (unsigned char)(c0 & 0xff);
+        out[1] = (unsigned char)(c0 >> 8);
+        out[2] = (unsigned char)(c1 & 0xff);
+        out[3] = (unsigned char)(c1 >> 8);
+        for (int i = 0; i < 4; ++i)
+            out[4 + i] = (unsigned char)(indices >> (i * 8));
+    }
+
+    // BC3 alpha block: max/min endpoints with six interpolated steps between them
+    static void encodeAlphaBlock(const unsigned char *texels, unsigned char *out)
+    {
+        int a0 = 0, a1 = 255;
+        for (int i = 0; i < 16; ++i)
+        {
+            a0 = std::max(a0, (int)texels[i * 4 + 3]);
+            a1 = std::min(a1, (int)texels[i * 4 + 3]);
+        }
+        uint64_t indices = 0;
+        if (a0 != a1)
+        {
+            int palette[8];
+            palette[0] = a0;
+            palette[1] = a1;
+            for (int i = 1; i <= 6; ++i)
+                palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+            for (int i = 0; i < 16; ++i)
+            {
+                int best = 0, bestError = 256;
+                for (int p = 0; p < 8; ++p)
+                {
+                    int error = std::abs(texels[i * 4 + 3] - palette[p]);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= (uint64_t)best << (i * 3);
+            }
+        }
+        out[0] = (unsigned char)a0;
+        out[1] = (unsigned char)a1;
+        for (int i = 0; i < 6; ++i)
+            out[2 + i] = (unsigned char)(indices >> (i * 8));
+    }
+
+    static std::vector<unsigned char> encodeBlocks(const unsigned char *rgba, int width, int height, ContainerFormat format)
+    {
+        const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        const size_t blockBytes = format == FORMAT_BC1 ? 8 : 16;
+        std::vector<unsigned char> blocks((size_t)blocksX * blocksY * blockBytes);
+        unsigned char texels[16 * 4];
+        unsigned char *out = blocks.data();
+        for (int by = 0; by < blocksY; ++by)
+        {
+            for (int bx = 0; bx < blocksX; ++bx)
+            {
+                // Partial blocks at the right/bottom edge repeat the last row/column
+                for (int y = 0; y < 4; ++y)
+                {
+                    int sy = std::min(by * 4 + y, height - 1);
+                    for (int x = 0; x < 4; ++x)
+                    {
+                        int sx = std::min(bx * 4 + x, width - 1);
+                        memcpy(&texels[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+                    }
+                }
+                if (format == FORMAT_BC3)
+                {
+                    encodeAlphaBlock(texels, out);
+                    out += 8;
+                }
+                encodeColorBlock(texels, out);
+                out += 8;
+            }
+        }
+        return blocks;
+    }
+
+    bool WriteTextureContainer(const std::string &path, const unsigned char *rgba, int width, int height,
+                               const TextureCacheOptions &options, const std::vector<GLTextureAtlas::Region> *regions)
+    {
+        if (!rgba || width <= 0 || height <= 0)
+            return false;
+
+        ContainerFormat format = FORMAT_RGBA8;
+        if (options.compression == TextureCompression::BC1)
+            format = FORMAT_BC1;
+        else if (options.compression == TextureCompression::BC3)
+            format = FORMAT_BC3;
+        else if (options.compression == TextureCompression::Auto)
+        {
+            format = FORMAT_BC1;
+            for (size_t i = 0; i < (size_t)width * height && format == FORMAT_BC1; ++i)
+                if (rgba[i * 4 + 3] != 255)
+                    format = FORMAT_BC3;
+        }
+
+        // Build the mip chain, then encode each level
+        std::vector<std::vector<unsigned char>> levels;
+        std::vector<MipEntry> mips;
+        {
+            std::vector<unsigned char> current(rgba, rgba + (size_t)width * height * 4);
+            int w = width, h = height;
+            for (;;)
+            {
+                MipEntry mip;
+                mip.width = (uint32_t)w;
+                mip.height = (uint32_t)h;
+                mip.offset = 0;
+                if (format == FORMAT_RGBA8)
+                    levels.push_back(current);
+                else
+                    levels.push_back(encodeBlocks(current.data(), w, h, format));
+                mip.size = levels.back().size();
+                mips.push_back(mip);
+                if (!options.mipmaps || (w == 1 && h == 1))
+                    break;
+                int nw, nh;
+                current = downsample(current.data(), w, h, nw, nh);
+                w = nw;
+                h = nh;
+            }
+        }
+
+        std::string names;
+        std::vector<RegionEntry> regionTable;
+        if (regions)
+        {
+            for (const GLTextureAtlas::Region &region : *regions)
+            {
+                RegionEntry entry;
+                entry.nameOffset = (uint32_t)names.size();
+                entry.nameLength = (uint32_t)region.name.size();
+                entry.x = region.x;
+                entry.y = region.y;
+                entry.width = region.width;
+                entry.height = region.height;
+                entry.u0 = region.u0;
+                entry.v0 = region.v0;
+                entry.u1 = region.u1;
+                entry.v1 = region.v1;
+                names += region.name;
+                regionTable.push_back(entry);
+            }
+        }
+
+        ContainerHeader header;
+        header.magic = kTextureCacheMagic;
+        header.version = kTextureCacheVersion;
+        header.format = format;
+        header.width = (uint32_t)width;
+        header.height = (uint32_t)height;
+        header.mipCount = (uint32_t)mips.size();
+        header.regionCount = (uint32_t)regionTable.size();
+        header.reserved = 0;
+
+        uint64_t offset = sizeof(header) + mips.size() * sizeof(MipEntry) + regionTable.size() * sizeof(RegionEntry) +
+                          names.size();
+        for (MipEntry &mip : mips)
+        {
+            offset = (offset + 15) & ~(uint64_t)15;
+            mip.offset = offset;
+            offset += mip.size;
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+        // Write to a temporary name first so a crash never leaves a truncated entry
+        std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+                return false;
+            file.write((const char *)&header, sizeof(header));
+            file.write((const char *)mips.data(), mips.size() * sizeof(MipEntry));
+            file.write((const char *)regionTable.data(), regionTable.size() * sizeof(RegionEntry));
+            file.write(names.data(), names.size());
+            for (size_t i = 0; i < mips.size(); ++i)
+            {
+                static const char zeros[16] = {};
+                uint64_t position = (uint64_t)file.tellp();
+                file.write(zeros, (std::streamsize)(mips[i].offset - position));
+                file.write((const char *)levels[i].data(), levels[i].size());
+            }
+            if (!file)
+                return false;
+        }
+        std::filesystem::rename(tmpPath, path, ec);
+        if (ec)
+            return false;
+        ++g_textureCacheStats.stores;
+        return true;
+    }
+
+    unsigned int StoreTextureCacheEntry(const std::string &path, const unsigned char *rgba, int width, int height,
+                                        const std::vector<GLTextureAtlas::Region> *regions)
+    {
+        ++g_textureCacheStats.misses;
+        if (path.empty() || !WriteTextureContainer(path, rgba, width, height, g_textureCacheOptions, regions))
+            return 0;
+        return LoadTextureContainer(path);
+    }
+
+    unsigned int LoadTextureContainer(const std::string &path, int *width, int *height,
+                                      std::vector<GLTextureAtlas::Region> *regions, unsigned int texture)
+    {
+        MappedFile file(path);
+        if (!file.data)
+            return 0;
+
+        auto reject = [&path]()
+        {
+            // Corrupt or from an older format: drop it so it gets rebuilt
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            ++g_textureCacheStats.rejected;
+            return 0u;
+        };
+
+        if (file.size < sizeof(ContainerHeader))
+            return reject();
+        ContainerHeader header;
+        memcpy(&header, file.data, sizeof(header));
+        if (header.magic != kTextureCacheMagic || header.version != kTextureCacheVersion || header.format > FORMAT_BC3 ||
+            header.mipCount == 0 || header.mipCount > 32)
+            return reject();
+        const size_t tablesEnd = sizeof(header) + header.mipCount * sizeof(MipEntry) +
+                                 (size_t)header.regionCount * sizeof(RegionEntry);
+        if (tablesEnd > file.size)
+            return reject();
+
+        std::vector<MipEntry> mips(header.mipCount);
+        memcpy(mips.data(), file.data + sizeof(header), mips.size() * sizeof(MipEntry));
+        for (const MipEntry &mip : mips)
+        {
+            if (mip.offset > file.size || mip.size > file.size - mip.offset)
+                return reject();
+        }
+
+        std::vector<GLTextureAtlas::Region> table;
+        if (header.regionCount > 0)
+        {
+            const unsigned char *entries = file.data + sizeof(header) + mips.size() * sizeof(MipEntry);
+            const char *names = (const char *)file.data + tablesEnd;
+            for (uint32_t i = 0; i < header.regionCount; ++i)
+            {
+                RegionEntry entry;
+                memcpy(&entry, entries + i * sizeof(RegionEntry), sizeof(entry));
+                if (tablesEnd + (size_t)entry.nameOffset + entry.nameLength > file.size)
+                    return reject();
+                GLTextureAtlas::Region region;
+                region.name.assign(names + entry.nameOffset, entry.nameLength);
+                region.x = entry.x;
+                region.y = entry.y;
+                region.width = entry.width;
+                region.height = entry.height;
+                region.u0 = entry.u0;
+                region.v0 = entry.v0;
+                region.u1 = entry.u1;
+                region.v1 = entry.v1;
+                table.push_back(std::move(region));
+            }
+        }
+
+        GLenum internalFormat = GL_RGBA;
+        if (header.format != FORMAT_RGBA8)
+        {
+            // Keep the entry; another machine (or driver) may well support it
+            if (!GLEW_EXT_texture_compression_s3tc)
+                return 0;
+            internalFormat = header.format == FORMAT_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                                         : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        }
+
+        GLuint texID = texture;
+        if (!texID)
+            glGenTextures(1, &texID);
+        glBindTexture(GL_TEXTURE_2D, texID);
+        for (size_t level = 0; level < mips.size(); ++level)
+        {
+            const MipEntry &mip = mips[level];
+            const unsigned char *pixels = file.data + mip.offset;
+            if (header.format == FORMAT_RGBA8)
+                glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA, mip.width, mip.height, 0, GL_RGBA,
+                             GL_UNSIGNED_BYTE, pixels);
+            else
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormat, mip.width, mip.height, 0,
+                                       (GLsizei)mip.size, pixels);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)mips.size() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mips.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        if (width)
+            *width = (int)header.width;
+        if (height)
+            *height = (int)header.height;
+        if (regions)
+            *regions = std::move(table);
+        ++g_textureCacheStats.hits;
+        return texID;
+    }
+}
@@ -0,0 +1,302 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include "DotBlue/DotBlue.h"
+#include "DotBlue/GLPlatform.h"
+#include "DotBlue/GLTextureLoader.h"
+#include "DotBlue/GLTextureRegistry.h"
+#include "DotBlue/JobSystem.h"
+#include "DotBlue/stb_image.h"
+
+namespace DotBlue
+{
+    static const size_t kDefaultUploadBudget = 4 << 20;
+
+    static size_t g_uploadBudget = kDefaultUploadBudget;
+    static unsigned int g_placeholderTexture = 0;
+
+    static unsigned int placeholderTexture()
+    {
+        if (!g_placeholderTexture)
+        {
+            const unsigned char grey[4] = {128, 128, 128, 255};
+            glGenTextures(1, &g_placeholderTexture);
+            glBindTexture(GL_TEXTURE_2D, g_placeholderTexture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        return g_placeholderTexture;
+    }
+
+    AsyncTexture::AsyncTexture(const std::string &filename)
+        : filename(filename), state(State::Decoding), textureID(0), width(0), height(0), pixels(nullptr),
+          rowsUploaded(0)
+    {
+    }
+
+    AsyncTexture::~AsyncTexture()
+    {
+        if (pixels)
+            stbi_image_free(pixels);
+        DeleteTexture(textureID);
+    }
+
+    unsigned int AsyncTexture::getTextureID() const
+    {
+        if (state.load() != State::Ready)
+            return placeholderTexture();
+        // Callers usually bind the id straight away, so count this as a use
+        TouchTexture(textureID);
+        return textureID;
+    }
+
+    // Decodes run as JobSystem jobs; the results queue up here for the render-thread uploads
+    struct TextureLoader
+    {
+        std::mutex mutex;
+        std::deque<TextureHandle> decoded; // Filled by decode jobs, drained by the render thread
+        size_t decoding = 0;               // Submitted, not in decoded yet
+
+        // Render thread only
+        std::deque<TextureHandle> uploads;
+        unsigned int pbo = 0;
+        bool usePBO = false;
+
+        static TextureHandle create(const std::string &filename)
+        {
+            return TextureHandle(new AsyncTexture(filename));
+        }
+
+        TextureLoader()
+        {
+            usePBO = GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object;
+            if (usePBO)
+                glGenBuffers(1, &pbo);
+        }
+
+        ~TextureLoader()
+        {
+            // Decode jobs point at this loader. The job system is shut down first, which
+            // runs them all, so this only waits if the loader goes away on its own.
+            while (decodingCount() > 0)
+            {
+                if (!GetJobSystem().runOne())
+                    std::this_thread::yield();
+            }
+            if (pbo)
+                glDeleteBuffers(1, &pbo);
+        }
+
+        size_t decodingCount()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return decoding;
+        }
+
+        void submit(TextureHandle texture)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++decoding;
+            }
+            GetJobSystem().submit([this, texture]() mutable { decode(std::move(texture)); });
+        }
+
+        void decode(TextureHandle texture)
+        {
+            // Decode into locals; the render thread only sees the results through the mutex.
+            // Skip the work when the job holds the last reference.
+            int width = 0, height = 0, channels = 0;
+            unsigned char *pixels = nullptr;
+            if (texture.use_count() > 1)
+            {
+                pixels = stbi_load(texture->filename.c_str(), &width, &height, &channels, 4);
+                if (!pixels)
+                {
+                    std::cerr << "Failed to load texture: " << texture->filename << std::endl;
+                    width = height = 0;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            texture->pixels = pixels;
+            texture->width = width;
+            texture->height = height;
+            decoded.push_back(std::move(texture));
+            --decoding;
+        }
+
+        void collectDecoded()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (TextureHandle &texture : decoded)
+            {
+                if (texture->pixels)
+                {
+                    texture->state = AsyncTexture::State::Uploading;
+                    uploads.push_back(std::move(texture));
+                }
+                else
+                {
+                    texture->state = AsyncTexture::State::Failed;
+                }
+            }
+            decoded.clear();
+        }
+
+        // Upload up to maxBytes of rows (at least one row); returns the bytes sent
+        size_t uploadRows(AsyncTexture &texture, size_t maxBytes)
+        {
+            const size_t rowBytes = (size_t)texture.width * 4;
+            if (!texture.textureID)
+            {
+                glGenTextures(1, &texture.textureID);
+                glBindTexture(GL_TEXTURE_2D, texture.textureID);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.width, texture.height, 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            }
+
+            int rows = (int)std::max<size_t>(1, maxBytes / rowBytes);
+            rows = std::min(rows, texture.height - texture.rowsUploaded);
+            const size_t bytes = rowBytes * rows;
+            const unsigned char *src = texture.pixels + rowBytes * texture.rowsUploaded;
+
+            glBindTexture(GL_TEXTURE_2D, texture.textureID);
+            if (usePBO)
+            {
+                // Orphan and refill: the driver hands back fresh storage while earlier bands
+                // are still being copied, and the copy into the texture runs asynchronously
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_DRAW);
+                void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bytes,
+                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+                if (dst)
+                {
+                    memcpy(dst, src, bytes);
+                    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, texture.rowsUploaded, texture.width, rows,
+                                    GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                }
+                else
+                {
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, texture.rowsUploaded, texture.width, rows,
+                                    GL_RGBA, GL_UNSIGNED_BYTE, src);
+                }
+            }
+            else
+            {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, texture.rowsUploaded, texture.width, rows,
+                                GL_RGBA, GL_UNSIGNED_BYTE, src);
+            }
+
+            texture.rowsUploaded += rows;
+            if (texture.rowsUploaded >= texture.height)
+            {
+                stbi_image_free(texture.pixels);
+                texture.pixels = nullptr;
+                const std::string filename = texture.filename;
+                RegisterTexture(texture.textureID, filename,
+                                [filename](unsigned int id) { return ReloadTextureFile(filename, id); });
+                texture.state = AsyncTexture::State::Ready;
+            }
+            return bytes;
+        }
+
+        void pump(size_t budget)
+        {
+            collectDecoded();
+            size_t spent = 0;
+            while (!uploads.empty())
+            {
+                TextureHandle &texture = uploads.front();
+                // Nobody holds the handle any more; skip the upload
+                if (texture.use_count() == 1)
+                {
+                    uploads.pop_front();
+                    continue;
+                }
+                if (spent > 0 && budget - spent < (size_t)texture->width * 4)
+                    break;
+                spent += uploadRows(*texture, spent < budget ? budget - spent : 0);
+                if (texture->isReady())
+                    uploads.pop_front();
+                if (spent >= budget)
+                    break;
+            }
+        }
+
+        size_t pending()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return decoding + decoded.size() + uploads.size();
+        }
+    };
+
+    static std::unique_ptr<TextureLoader> g_textureLoader = nullptr;
+
+    TextureHandle LoadTextureAsync(const std::string &filename)
+    {
+        if (!g_textureLoader)
+            g_textureLoader = std::make_unique<TextureLoader>();
+
+        TextureHandle texture = TextureLoader::create(filename);
+        g_textureLoader->submit(texture);
+        return texture;
+    }
+
+    void SetTextureUploadBudget(size_t bytesPerFrame)
+    {
+        g_uploadBudget = bytesPerFrame;
+    }
+
+    size_t GetPendingTextureCount()
+    {
+        return g_textureLoader ? g_textureLoader->pending() : 0;
+    }
+
+    void FinishTextureLoads()
+    {
+        if (!g_textureLoader)
+            return;
+        while (g_textureLoader->pending() > 0)
+        {
+            g_textureLoader->pump(SIZE_MAX);
+            // Help with the decodes rather than wait for the pool
+            if (g_textureLoader->pending() > 0 && !GetJobSystem().runOne())
+                std::this_thread::yield();
+        }
+    }
+
+    void PumpTextureUploads()
+    {
+        if (g_textureLoader)
+            g_textureLoader->pump(g_uploadBudget);
+    }
+
+    void ShutdownTextureLoader()
+    {
+        // Decodes still queued have run by now (ShutdownJobSystem); their uploads are dropped
+        g_textureLoader.reset();
+        if (g_placeholderTexture)
+        {
+            glDeleteTextures(1, &g_placeholderTexture);
+            g_placeholderTexture = 0;
+        }
+    }
+}
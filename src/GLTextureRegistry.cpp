@@ -0,0 +1,260 @@
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include "DotBlue/DotBlue.h"
+#include "DotBlue/GLPlatform.h"
+#include "DotBlue/GLTextureRegistry.h"
+
+namespace DotBlue
+{
+    struct RegisteredTexture
+    {
+        std::string name;
+        TextureRestoreFn restore;
+        GLenum target;
+        size_t bytes;       // Size when resident
+        bool resident;
+        uint64_t lastUsed;
+        // Sampling state saved at eviction and re-applied after the restore
+        GLint minFilter, magFilter, wrapS, wrapT, maxLevel;
+    };
+
+    static std::unordered_map<unsigned int, RegisteredTexture> g_textures;
+    static TextureMemoryStats g_textureMemory;
+    static uint64_t g_textureFrame = 1;
+
+    // Sum of every allocated level; compressed levels report their own size
+    static size_t queryTextureBytes(GLenum target, unsigned int textureID)
+    {
+        GLint previous = 0;
+        glGetIntegerv(target == GL_TEXTURE_2D_ARRAY ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D, &previous);
+        glBindTexture(target, textureID);
+        size_t bytes = 0;
+        for (GLint level = 0; level < 16; ++level)
+        {
+            GLint width = 0, height = 0, depth = 1, compressed = GL_FALSE;
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+            if (width <= 0 || height <= 0)
+                break;
+            if (target == GL_TEXTURE_2D_ARRAY)
+                glGetTexLevelParameteriv(target, level, GL_TEXTURE_DEPTH, &depth);
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &compressed);
+            if (compressed)
+            {
+                GLint size = 0;
+                glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+                bytes += (size_t)size;
+                continue;
+            }
+            GLint bits = 0;
+            static const GLenum channels[4] = {GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE,
+                                               GL_TEXTURE_ALPHA_SIZE};
+            for (GLenum channel : channels)
+            {
+                GLint size = 0;
+                glGetTexLevelParameteriv(target, level, channel, &size);
+                bits += size;
+            }
+            bytes += (size_t)width * height * depth * std::max(1, (bits + 7) / 8);
+        }
+        glBindTexture(target, (GLuint)previous);
+        return bytes;
+    }
+
+    static void updateResidentBytes(size_t add, size_t remove)
+    {
+        g_textureMemory.residentBytes += add;
+        g_textureMemory.residentBytes -= std::min(remove, g_textureMemory.residentBytes);
+        g_textureMemory.peakBytes = std::max(g_textureMemory.peakBytes, g_textureMemory.residentBytes);
+    }
+
+    static void evictTexture(unsigned int textureID, RegisteredTexture &texture)
+    {
+        const GLenum target = texture.target;
+        glBindTexture(target, textureID);
+        glGetTexParameteriv(target, GL_TEXTURE_MIN_FILTER, &texture.minFilter);
+        glGetTexParameteriv(target, GL_TEXTURE_MAG_FILTER, &texture.magFilter);
+        glGetTexParameteriv(target, GL_TEXTURE_WRAP_S, &texture.wrapS);
+        glGetTexParameteriv(target, GL_TEXTURE_WRAP_T, &texture.wrapT);
+        glGetTexParameteriv(target, GL_TEXTURE_MAX_LEVEL, &texture.maxLevel);
+
+        // Shrink level 0 to one grey texel and release the rest of the mip chain
+        const unsigned char grey[4] = {128, 128, 128, 255};
+        glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        for (GLint level = 1; level < 16; ++level)
+        {
+            GLint width = 0;
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+            if (width <= 0)
+                break;
+            glTexImage2D(target, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        texture.resident = false;
+        updateResidentBytes(0, texture.bytes);
+        ++g_textureMemory.evicted;
+        ++g_textureMemory.evictions;
+    }
+
+    static void restoreTexture(unsigned int textureID, RegisteredTexture &texture)
+    {
+        texture.resident = true;
+        --g_textureMemory.evicted;
+        if (!texture.restore(textureID))
+        {
+            // Keep the placeholder and stop evicting it; the source is gone
+            std::cerr << "[TextureRegistry] Failed to restore texture: " << texture.name << std::endl;
+            texture.restore = nullptr;
+            texture.bytes = queryTextureBytes(texture.target, textureID);
+            updateResidentBytes(texture.bytes, 0);
+            return;
+        }
+        const GLenum target = texture.target;
+        glBindTexture(target, textureID);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, texture.minFilter);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, texture.magFilter);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, texture.wrapS);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, texture.wrapT);
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, texture.maxLevel);
+        texture.bytes = queryTextureBytes(target, textureID);
+        updateResidentBytes(texture.bytes, 0);
+        ++g_textureMemory.restores;
+    }
+
+    void SetTextureMemoryBudget(size_t bytes)
+    {
+        g_textureMemory.budgetBytes = bytes;
+    }
+
+    TextureMemoryStats GetTextureMemoryStats()
+    {
+        TextureMemoryStats stats = g_textureMemory;
+        stats.textures = (unsigned int)g_textures.size();
+        return stats;
+    }
+
+    std::vector<TextureInfo> GetTextureList()
+    {
+        std::vector<TextureInfo> list;
+        list.reserve(g_textures.size());
+        for (const auto &entry : g_textures)
+        {
+            const RegisteredTexture &texture = entry.second;
+            list.push_back({entry.first, texture.name, texture.bytes, texture.resident, (bool)texture.restore,
+                            texture.lastUsed});
+        }
+        std::sort(list.begin(), list.end(), [](const TextureInfo &a, const TextureInfo &b)
+        {
+            return a.bytes != b.bytes ? a.bytes > b.bytes : a.textureID < b.textureID;
+        });
+        return list;
+    }
+
+    void TouchTexture(unsigned int textureID)
+    {
+        auto it = g_textures.find(textureID);
+        if (it == g_textures.end())
+            return;
+        it->second.lastUsed = g_textureFrame;
+        if (!it->second.resident)
+            restoreTexture(textureID, it->second);
+    }
+
+    void BindTexture(unsigned int textureID)
+    {
+        TouchTexture(textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+    }
+
+    void RegisterTexture(unsigned int textureID, const std::string &name, TextureRestoreFn restore, bool layered)
+    {
+        if (!textureID)
+            return;
+        UnregisterTexture(textureID);
+        RegisteredTexture texture;
+        texture.name = name;
+        texture.restore = std::move(restore);
+        texture.target = layered ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        texture.bytes = queryTextureBytes(texture.target, textureID);
+        texture.resident = true;
+        texture.lastUsed = g_textureFrame;
+        texture.minFilter = GL_LINEAR;
+        texture.magFilter = GL_LINEAR;
+        texture.wrapS = texture.wrapT = GL_CLAMP_TO_EDGE;
+        texture.maxLevel = 1000;
+        updateResidentBytes(texture.bytes, 0);
+        g_textures.emplace(textureID, std::move(texture));
+    }
+
+    void UnregisterTexture(unsigned int textureID)
+    {
+        auto it = g_textures.find(textureID);
+        if (it == g_textures.end())
+            return;
+        if (it->second.resident)
+            updateResidentBytes(0, it->second.bytes);
+        else
+            --g_textureMemory.evicted;
+        g_textures.erase(it);
+    }
+
+    void DeleteTexture(unsigned int textureID)
+    {
+        if (!textureID)
+            return;
+        UnregisterTexture(textureID);
+        glDeleteTextures(1, &textureID);
+    }
+
+    void UpdateTextureSize(unsigned int textureID)
+    {
+        auto it = g_textures.find(textureID);
+        if (it == g_textures.end() || !it->second.resident)
+            return;
+        const size_t bytes = queryTextureBytes(it->second.target, textureID);
+        updateResidentBytes(bytes, it->second.bytes);
+        it->second.bytes = bytes;
+    }
+
+    void EnforceTextureBudget()
+    {
+        ++g_textureFrame;
+        const size_t budget = g_textureMemory.budgetBytes;
+        if (budget == 0 || g_textureMemory.residentBytes <= budget)
+            return;
+
+        // Least recently used first; anything used last frame is still in the working set
+        std::vector<std::pair<uint64_t, unsigned int>> candidates;
+        for (const auto &entry : g_textures)
+        {
+            const RegisteredTexture &texture = entry.second;
+            if (texture.resident && texture.restore && texture.target == GL_TEXTURE_2D &&
+                texture.lastUsed + 1 < g_textureFrame)
+                candidates.push_back({texture.lastUsed, entry.first});
+        }
+        std::sort(candidates.begin(), candidates.end());
+        GLint previous = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+        for (const auto &candidate : candidates)
+        {
+            if (g_textureMemory.residentBytes <= budget)
+                break;
+            evictTexture(candidate.second, g_textures[candidate.second]);
+        }
+        glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+    }
+
+    void ShutdownTextureRegistry()
+    {
+        g_textures.clear();
+        g_textureMemory = TextureMemoryStats();
+    }
+}
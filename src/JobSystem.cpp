@@ -0,0 +1,133 @@
+#include <memory>
+#include <algorithm>
+#include "DotBlue/JobSystem.h"
+
+namespace DotBlue
+{
+    JobSystem::JobSystem(unsigned int threads)
+    {
+        if (threads == 0)
+        {
+            // hardware_concurrency() may report 0 when it can't tell
+            const unsigned int cores = std::thread::hardware_concurrency();
+            threads = cores > 1 ? cores - 1 : 1;
+        }
+        for (unsigned int i = 0; i < threads; ++i)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    JobSystem::~JobSystem()
+    {
+        waitIdle();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    void JobSystem::submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+    void JobSystem::finish()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --running;
+        if (running == 0 && queue.empty())
+            idle.notify_all();
+    }
+
+    bool JobSystem::runOne()
+    {
+        std::function<void()> job;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (queue.empty())
+                return false;
+            job = std::move(queue.front());
+            queue.pop_front();
+            ++running;
+        }
+        job();
+        finish();
+        return true;
+    }
+
+    void JobSystem::waitIdle()
+    {
+        while (runOne())
+        {
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return running == 0 && queue.empty(); });
+    }
+
+    void JobSystem::workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                job = std::move(queue.front());
+                queue.pop_front();
+                ++running;
+            }
+            job();
+            finish();
+        }
+    }
+
+    void JobSystem::parallelFor(size_t count, const std::function<void(size_t)> &fn)
+    {
+        // One job per worker pulling indices from a shared counter, plus the calling thread
+        std::atomic<size_t> next(0);
+        auto drain = [&]
+        {
+            for (size_t i = next++; i < count; i = next++)
+                fn(i);
+        };
+        const size_t helpers = std::min<size_t>(workers.size(), count > 0 ? count - 1 : 0);
+        std::atomic<size_t> helpersLeft(helpers);
+        for (size_t h = 0; h < helpers; ++h)
+        {
+            submit([&]
+            {
+                drain();
+                --helpersLeft;
+            });
+        }
+        drain();
+        // fn and the counters live on this stack, so wait for every helper to leave
+        while (helpersLeft > 0)
+        {
+            if (!runOne())
+                std::this_thread::yield();
+        }
+    }
+
+    static std::unique_ptr<JobSystem> g_jobSystem;
+
+    JobSystem &GetJobSystem()
+    {
+        if (!g_jobSystem)
+            g_jobSystem = std::make_unique<JobSystem>();
+        return *g_jobSystem;
+    }
+
+    void ShutdownJobSystem()
+    {
+        g_jobSystem.reset();
+    }
+}